@@ -0,0 +1,77 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+#include "args.h"
+#include "log.h"
+
+#include <cerrno> // errno
+#include <cstdlib> // strtoull
+
+
+bool ParseUint64(const char* s, uint64& v)
+{
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long t = std::strtoull(s, &end, 10);
+    if (!*s || *s == '-' || *end || errno == ERANGE)
+        return false;
+    v = uint64(t);
+    return true;
+}
+
+bool ParseUint32(const char* s, uint32& v)
+{
+    uint64 t;
+    if (!ParseUint64(s, t) || t > UINT32_MAX)
+        return false;
+    v = uint32(t);
+    return true;
+}
+
+ArgResult ParseGameArg(int argc, char* argv[], int& i, GameMode& mode, uint64& seed, bool& seedSet)
+{
+    std::string arg = argv[i];
+    if (arg == "--beginner")
+    {
+        mode = GAME_MODE_BEGINNER;
+    }
+    else if (arg == "--intermediate")
+    {
+        mode = GAME_MODE_INTERMEDIATE;
+    }
+    else if (arg == "--expert")
+    {
+        mode = GAME_MODE_EXPERT;
+    }
+    else if (arg == "--custom")
+    {
+        GameMode m = {"custom", 0, 0, 0};
+        if (i + 3 >= argc || !ParseUint32(argv[i+1], m.rows) || !ParseUint32(argv[i+2], m.cols) || !ParseUint32(argv[i+3], m.mines))
+        {
+            LOG_FAIL("--custom expects <rows> <cols> <mines>.");
+            return ARG_INVALID;
+        }
+        mode = m;
+        i += 3;
+    }
+    else if (arg == "--seed")
+    {
+        if (i + 1 >= argc || !ParseUint64(argv[i+1], seed))
+        {
+            LOG_FAIL("--seed expects an unsigned 64 bit integer.");
+            return ARG_INVALID;
+        }
+        seedSet = true;
+        i++;
+    }
+    else
+    {
+        return ARG_UNKNOWN;
+    }
+    
+    return ARG_OK;
+}
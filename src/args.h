@@ -0,0 +1,30 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+#ifndef ARGS_H
+#define ARGS_H
+
+#include "common.h"
+#include "board.h"
+
+
+enum ArgResult
+{
+    ARG_UNKNOWN, // Not an argument this parser handles; argv[i] is untouched.
+    ARG_OK,
+    ARG_INVALID // Recognized but malformed; an error has been logged.
+};
+
+#define GAME_ARGS_USAGE "[--beginner | --intermediate | --expert | --custom <rows> <cols> <mines>] [--seed <n>]"
+
+bool ParseUint64(const char* s, uint64& v);
+bool ParseUint32(const char* s, uint32& v);
+
+// Parses the game mode and seed arguments shared by every executable; i is advanced past any values consumed.
+ArgResult ParseGameArg(int argc, char* argv[], int& i, GameMode& mode, uint64& seed, bool& seedSet);
+
+#endif
@@ -0,0 +1,216 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+#include "batch.h"
+#include "random.h"
+
+#include <algorithm> // max, min
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+
+/*
+    A worker's remaining chunks [begin, end) packed into one word as begin << 32 | end, so the owner taking
+    from the front and thieves taking from the back are both a single compare-and-swap.
+    Chunks are never created after the start, so a worker may stop once every queue looks empty.
+*/
+struct alignas(64) BatchQueue
+{
+    std::atomic<uint64> range{0};
+};
+
+struct alignas(64) BatchWorker
+{
+    Board board;
+    Solver solver;
+    BatchStats stats;
+};
+
+static uint64 PackRange(uint32 begin, uint32 end) { return (uint64(begin) << 32) | end; }
+static uint32 RangeBegin(uint64 range) { return uint32(range >> 32); }
+static uint32 RangeEnd(uint64 range) { return uint32(range); }
+
+void BatchStats::Add(const BatchStats& other)
+{
+    games += other.games;
+    wins += other.wins;
+    losses += other.losses;
+    moves += other.moves;
+    guesses += other.guesses;
+    nanoseconds += other.nanoseconds;
+    minNanoseconds = std::min(minNanoseconds, other.minNanoseconds);
+    maxNanoseconds = std::max(maxNanoseconds, other.maxNanoseconds);
+}
+
+uint64 BatchGameSeed(uint64 seed, uint64 game)
+{
+    // The game'th output of a splitmix64 stream seeded with seed, computed without stepping through the others.
+    uint64 state = seed + game * 0x9E3779B97F4A7C15ULL;
+    return SplitMix64(state);
+}
+
+// Reveals a random covered cell that is not a known mine.
+static void Guess(Board& board, Random& rng, const Solver& solver)
+{
+    for (;;)
+    {
+        uint32 i = rng.Below(board.CellCount());
+        uint32 r = i / board.Cols();
+        uint32 c = i % board.Cols();
+        if (!board.IsRevealed(r, c) && solver.Known(i) != KNOWN_MINE)
+        {
+            board.Reveal(r, c);
+            return;
+        }
+    }
+}
+
+void PlayGame(Board& board, Solver& solver, BatchPlayer player, uint64 gameSeed, BatchStats& stats)
+{
+    Random rng(gameSeed);
+    board.Generate(rng.Next());
+    if (player == BATCH_SOLVER)
+        solver.Reset(board);
+    
+    while (board.State() == GAME_PLAYING)
+    {
+        uint32 cell;
+        if (player == BATCH_RANDOM)
+        {
+            uint32 i = rng.Below(board.CellCount());
+            if (board.IsRevealed(i / board.Cols(), i % board.Cols()))
+                continue;
+            board.Reveal(i / board.Cols(), i % board.Cols());
+        }
+        else
+        {
+            if (solver.NextSafe(board, cell))
+            {
+                board.Reveal(cell / board.Cols(), cell % board.Cols());
+            }
+            else
+            {
+                Guess(board, rng, solver);
+                stats.guesses++;
+            }
+            solver.Update(board);
+        }
+        stats.moves++;
+    }
+    
+    stats.games++;
+    if (board.State() == GAME_WON)
+        stats.wins++;
+    else
+        stats.losses++;
+}
+
+// Takes the front chunk of the worker's own queue.
+static bool PopChunk(BatchQueue& queue, uint32& chunk)
+{
+    uint64 range = queue.range.load(std::memory_order_relaxed);
+    while (RangeBegin(range) < RangeEnd(range))
+    {
+        if (queue.range.compare_exchange_weak(range, PackRange(RangeBegin(range) + 1, RangeEnd(range)), std::memory_order_relaxed))
+        {
+            chunk = RangeBegin(range);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Takes the back half of victim's remaining chunks.
+static bool StealChunks(BatchQueue& victim, uint32& begin, uint32& end)
+{
+    uint64 range = victim.range.load(std::memory_order_relaxed);
+    while (RangeBegin(range) < RangeEnd(range))
+    {
+        uint32 half = (RangeEnd(range) - RangeBegin(range) + 1) / 2;
+        if (victim.range.compare_exchange_weak(range, PackRange(RangeBegin(range), RangeEnd(range) - half), std::memory_order_relaxed))
+        {
+            begin = RangeEnd(range) - half;
+            end = RangeEnd(range);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void RunWorker(uint32 self, std::vector<BatchQueue>& queues, BatchWorker& worker, BatchPlayer player, uint64 seed, uint64 games, uint64 chunkGames)
+{
+    uint32 count = uint32(queues.size());
+    for (;;)
+    {
+        uint32 chunk;
+        if (!PopChunk(queues[self], chunk))
+        {
+            // Only thieves write to a queue that is not empty, and this one is empty, so a plain store is safe.
+            uint32 begin = 0;
+            uint32 end = 0;
+            bool stole = false;
+            for (uint32 i = 1; i < count && !stole; i++)
+                stole = StealChunks(queues[(self + i) % count], begin, end);
+            if (!stole)
+                return;
+            
+            chunk = begin;
+            queues[self].range.store(PackRange(begin + 1, end), std::memory_order_relaxed);
+        }
+        
+        uint64 first = uint64(chunk) * chunkGames;
+        uint64 last = std::min(first + chunkGames, games);
+        for (uint64 g = first; g < last; g++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            PlayGame(worker.board, worker.solver, player, BatchGameSeed(seed, g), worker.stats);
+            uint64 ns = uint64(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+            worker.stats.nanoseconds += ns;
+            worker.stats.minNanoseconds = std::min(worker.stats.minNanoseconds, ns);
+            worker.stats.maxNanoseconds = std::max(worker.stats.maxNanoseconds, ns);
+        }
+    }
+}
+
+ResultBool RunBatch(const GameMode& mode, BatchPlayer player, uint64 seed, uint64 games, uint32 threads, BatchStats& stats)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    
+    // Chunk indices must fit the 32 bit halves of a queue's range.
+    uint64 chunkGames = std::max<uint64>(BATCH_CHUNK_GAMES, (games >> 31) + 1);
+    uint64 chunks = (games + chunkGames - 1) / chunkGames;
+    threads = uint32(std::max<uint64>(1, std::min<uint64>(threads, chunks)));
+    
+    std::vector<BatchWorker> workers(threads);
+    for (BatchWorker& worker : workers)
+    {
+        ResultBool ret = worker.board.Init(mode.rows, mode.cols, mode.mines);
+        if (!ret)
+            return ret;
+    }
+    
+    std::vector<BatchQueue> queues(threads);
+    for (uint32 i = 0; i < threads; i++)
+        queues[i].range.store(PackRange(uint32(chunks * i / threads), uint32(chunks * (i + 1) / threads)));
+    
+    // The calling thread is worker 0.
+    std::vector<std::thread> pool;
+    for (uint32 i = 1; i < threads; i++)
+        pool.emplace_back(RunWorker, i, std::ref(queues), std::ref(workers[i]), player, seed, games, chunkGames);
+    RunWorker(0, queues, workers[0], player, seed, games, chunkGames);
+    for (std::thread& t : pool)
+        t.join();
+    
+    for (const BatchWorker& worker : workers)
+        stats.Add(worker.stats);
+    
+    ResultBool ret = {true, ""};
+    return ret;
+}
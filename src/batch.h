@@ -0,0 +1,54 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "common.h"
+#include "board.h"
+#include "solver.h"
+
+
+// Games are handed out to workers in chunks of at least this many.
+#define BATCH_CHUNK_GAMES 64
+
+enum BatchPlayer
+{
+    BATCH_RANDOM, // Reveals random covered cells.
+    BATCH_SOLVER // Reveals provably safe cells and only guesses when the solver is stuck.
+};
+
+struct BatchStats
+{
+    uint64 games = 0;
+    uint64 wins = 0;
+    uint64 losses = 0;
+    uint64 moves = 0;
+    uint64 guesses = 0;
+    // Wall time spent inside games; unlike the counts above these vary from run to run.
+    uint64 nanoseconds = 0;
+    uint64 minNanoseconds = UINT64_MAX;
+    uint64 maxNanoseconds = 0;
+    
+    void Add(const BatchStats& other);
+};
+
+// Seed of the game'th game of a batch; depends only on (seed, game), never on which worker plays it.
+uint64 BatchGameSeed(uint64 seed, uint64 game);
+
+// Generates board from gameSeed and plays it to the end; every random choice is drawn from gameSeed.
+void PlayGame(Board& board, Solver& solver, BatchPlayer player, uint64 gameSeed, BatchStats& stats);
+
+/*
+    Plays games [0, games) of a batch across threads workers (0 picks one per hardware thread).
+    Each worker owns its board, solver and stats; the game ranges are split evenly up front and idle workers
+    steal half of a busy worker's remaining range, so no locks are taken while playing.
+    Every count in stats is the same for a given (mode, player, seed, games) whatever the thread count.
+*/
+ResultBool RunBatch(const GameMode& mode, BatchPlayer player, uint64 seed, uint64 games, uint32 threads, BatchStats& stats);
+
+#endif
@@ -0,0 +1,500 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+/*
+    Benchmarks the board and solver kernels without SDL, video or audio, so it runs on any machine, and the game's
+    frame drawing when it is built along with the game.
+
+    Every case runs on an expert board and on 1000x1000 and 10000x10000 boards of the same density:
+        generate: Board::Generate, the work behind a new game (per cell).
+        count: Board::CountNeighbors over the whole board (per cell).
+        reveal: the first reveal in the middle of a fresh board, opening included (per cell revealed).
+        chord: chords every revealed number of an opened board whose mines next to revealed cells are flagged,
+            flooding from what they reveal (per chord).
+        solver: plays an opened board with Solver::NextSafe and Track until it is stuck or won (per move).
+        flood: the first reveal on a board with one mine per BENCH_FLOOD_DENSITY cells, so nearly all of it
+            floods open (per cell revealed).
+        render: DrawCells of every visible cell into a 1280x720 software surface, timed by the game itself in
+            "minesweeper --offscreen --full-frames" while it plays a scripted game (per frame). Only built with
+            the game (BENCH_GAME_PATH); the game needs no window, display or audio for it.
+    A case repeats until it ran for --min-time milliseconds and BENCH_MIN_ITERATIONS times; boards are set up
+    outside the timed part. render draws BENCH_RENDER_FRAMES frames instead.
+
+    --filter <text> runs only the cases whose name ("expert/count", "1000x1000/flood", ...) contains text.
+    --json <file> writes the results, one case per line; --baseline <file> compares them against such a file
+    and fails if any case got slower per operation by more than --threshold percent (default 10). The comparison
+    uses each case's fastest run, which other load on the machine disturbs far less than the median.
+*/
+
+#include "common.h"
+#include "args.h"
+#include "batch.h"
+#include "board.h"
+#include "log.h"
+#include "solver.h"
+
+#include <algorithm> // sort, min
+#include <chrono>
+#include <cstdio> // snprintf, printf
+#include <cstdlib> // system
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+
+
+#define BENCH_MIN_ITERATIONS 3
+#define BENCH_DEFAULT_MIN_TIME_MS 200
+#define BENCH_DEFAULT_THRESHOLD 10
+#define BENCH_FLOOD_DENSITY 100
+// Longest game the solver case plays, so a huge board that keeps opening up still ends.
+#define BENCH_SOLVER_MOVES (1 << 20)
+#define BENCH_RENDER_FRAMES 300
+
+struct BenchSize
+{
+    const char* name;
+    uint32 rows;
+    uint32 cols;
+};
+
+static const BenchSize BENCH_SIZES[] =
+{
+    {GAME_MODE_EXPERT.name, GAME_MODE_EXPERT.rows, GAME_MODE_EXPERT.cols},
+    {"1000x1000", 1000, 1000},
+    {"10000x10000", 10000, 10000},
+};
+
+struct BenchResult
+{
+    std::string name;
+    const BenchSize* size;
+    uint32 mines;
+    uint64 iterations;
+    real64 ops; // Mean operations per iteration.
+    real64 medianNs; // Per operation.
+    real64 minNs;
+    real64 meanNs;
+};
+
+static std::string g_filter;
+static uint64 g_minTimeNs = uint64(BENCH_DEFAULT_MIN_TIME_MS) * 1000000;
+static std::vector<BenchResult> g_results;
+
+static uint64 BenchNow()
+{
+    return uint64(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static bool Selected(const BenchSize& size, const char* name)
+{
+    return (std::string(size.name) + "/" + name).find(g_filter) != std::string::npos;
+}
+
+// Mines of the expert density on a board of size.
+static uint32 ExpertMines(const BenchSize& size)
+{
+    return uint32(uint64(size.rows) * size.cols * GAME_MODE_EXPERT.mines / (GAME_MODE_EXPERT.rows * GAME_MODE_EXPERT.cols));
+}
+
+// Records and prints a case from the time per operation of each iteration; perOp must not be empty.
+static void AddResult(const BenchSize& size, const char* name, uint32 mines, std::vector<real64>& perOp, uint64 totalNs, uint64 totalOps)
+{
+    std::sort(perOp.begin(), perOp.end());
+    
+    BenchResult result;
+    result.name = std::string(size.name) + "/" + name;
+    result.size = &size;
+    result.mines = mines;
+    result.iterations = perOp.size();
+    result.ops = real64(totalOps) / perOp.size();
+    result.medianNs = perOp[perOp.size() / 2];
+    result.minNs = perOp[0];
+    result.meanNs = real64(totalNs) / std::max<uint64>(totalOps, 1);
+    g_results.push_back(result);
+    std::printf("%-24s %8" PRIu64 " runs %14.1f ops %12.3f ns/op (min %.3f, mean %.3f)\n", result.name.c_str(), result.iterations,
+                result.ops, result.medianNs, result.minNs, result.meanNs);
+}
+
+/*
+    Calls setup() untimed and then times body(), which returns how many operations it did, until the case ran long
+    and often enough. Per operation times of the iterations give the median and minimum.
+*/
+template <typename Setup, typename Body>
+static void RunCase(const BenchSize& size, const char* name, uint32 mines, Setup setup, Body body)
+{
+    if (!Selected(size, name))
+        return;
+    
+    std::vector<real64> perOp;
+    uint64 totalNs = 0;
+    uint64 totalOps = 0;
+    while (perOp.size() < BENCH_MIN_ITERATIONS || totalNs < g_minTimeNs)
+    {
+        setup();
+        uint64 start = BenchNow();
+        uint64 ops = body();
+        uint64 ns = BenchNow() - start;
+        totalNs += ns;
+        totalOps += ops;
+        perOp.push_back(real64(ns) / std::max<uint64>(ops, 1));
+    }
+    AddResult(size, name, mines, perOp, totalNs, totalOps);
+}
+
+// Flags every mine next to a revealed cell, as a player who has read the opening would.
+static void FlagBorder(Board& board)
+{
+    for (uint32 r = 0; r < board.Rows(); r++)
+    {
+        for (uint32 c = 0; c < board.Cols(); c++)
+        {
+            if (!board.IsMine(r, c))
+                continue;
+            
+            bool border = false;
+            for (int32 dr = -1; dr <= 1 && !border; dr++)
+            {
+                for (int32 dc = -1; dc <= 1 && !border; dc++)
+                    border = board.InBounds(int64(r) + dr, int64(c) + dc) && board.IsRevealed(r + dr, c + dc);
+            }
+            if (border)
+                board.SetFlagged(r, c, true);
+        }
+    }
+}
+
+static void RunSize(const BenchSize& size, uint64 seed)
+{
+    const char* names[] = {"generate", "count", "reveal", "chord", "solver", "flood"};
+    bool any = false;
+    for (const char* name : names)
+        any = any || Selected(size, name);
+    if (!any)
+        return;
+    
+    uint32 mines = ExpertMines(size);
+    uint32 floodMines = std::max(1u, uint32(uint64(size.rows) * size.cols / BENCH_FLOOD_DENSITY));
+    // Boards are large enough that the cases share them: fresh holds the untouched deal that every case copies.
+    std::unique_ptr<Board> fresh(new Board);
+    std::unique_ptr<Board> board(new Board);
+    fresh->Init(size.rows, size.cols, mines);
+    fresh->Generate(seed);
+    *board = *fresh;
+    
+    uint64 game = 0;
+    RunCase(size, "generate", mines, [&]() {}, [&]()
+    {
+        board->Generate(BatchGameSeed(seed, game++));
+        return uint64(board->CellCount());
+    });
+    RunCase(size, "count", mines, [&]() {}, [&]()
+    {
+        board->CountNeighbors();
+        return uint64(board->CellCount());
+    });
+    RunCase(size, "reveal", mines, [&]() { *board = *fresh; }, [&]()
+    {
+        board->Reveal(size.rows / 2, size.cols / 2);
+        return uint64(board->RevealedCount());
+    });
+    
+    // The remaining cases start from the opened board.
+    *board = *fresh;
+    board->Reveal(size.rows / 2, size.cols / 2);
+    std::unique_ptr<Board> opened(new Board(*board));
+    
+    std::vector<uint32> numbers;
+    if (Selected(size, "chord"))
+    {
+        FlagBorder(*board);
+        for (uint32 r = 0; r < size.rows; r++)
+        {
+            for (uint32 c = 0; c < size.cols; c++)
+            {
+                if (board->IsRevealed(r, c) && board->MinesNearby(r, c) > 0)
+                    numbers.push_back(board->Index(r, c));
+            }
+        }
+        std::unique_ptr<Board> flagged(new Board(*board));
+        RunCase(size, "chord", mines, [&]() { *board = *flagged; }, [&]()
+        {
+            for (uint32 cell : numbers)
+                board->Chord(cell / size.cols, cell % size.cols);
+            return uint64(numbers.size());
+        });
+    }
+    
+    Solver solver;
+    RunCase(size, "solver", mines, [&]() { *board = *opened; }, [&]()
+    {
+        solver.Reset(*board);
+        uint64 moves = 0;
+        uint32 cell;
+        while (moves < BENCH_SOLVER_MOVES && board->State() == GAME_PLAYING && solver.NextSafe(*board, cell))
+        {
+            board->Reveal(cell / size.cols, cell % size.cols);
+            solver.Track(*board);
+            moves++;
+        }
+        return moves;
+    });
+    
+    if (Selected(size, "flood"))
+    {
+        fresh->Init(size.rows, size.cols, floodMines);
+        fresh->Generate(seed);
+        RunCase(size, "flood", floodMines, [&]() { *board = *fresh; }, [&]()
+        {
+            board->Reveal(size.rows / 2, size.cols / 2);
+            return uint64(board->RevealedCount());
+        });
+    }
+}
+
+#if defined(BENCH_GAME_PATH)
+// Plays a scripted game on a board of size in the game's offscreen mode and reads back how long each frame took to draw.
+static ResultBool RunRender(const BenchSize& size, uint64 seed)
+{
+    ResultBool ret = {false, ""};
+    if (!Selected(size, "render"))
+    {
+        ret.result = true;
+        return ret;
+    }
+    
+    uint32 mines = ExpertMines(size);
+    std::string times = (std::filesystem::temp_directory_path() / "minesweeper_bench_frames.txt").string();
+    std::ostringstream command;
+    command << '"' << BENCH_GAME_PATH << "\" --custom " << size.rows << ' ' << size.cols << ' ' << mines << " --seed " << seed
+            << " --offscreen " << BENCH_RENDER_FRAMES << " --full-frames --data \"" << BENCH_DATA_DIR << "\" --frame-times \"" << times << '"';
+#if defined(OS_WINDOWS)
+    // cmd.exe drops the first and last quote of a command line that starts with one.
+    std::string line = "\"" + command.str() + " > NUL\"";
+#else
+    std::string line = command.str() + " > /dev/null";
+#endif
+    if (std::system(line.c_str()) != 0)
+    {
+        ret.error = "The game failed to render offscreen: " + command.str();
+        return ret;
+    }
+    
+    std::vector<real64> perFrame;
+    uint64 totalNs = 0;
+    {
+        std::ifstream in(times);
+        uint64 ns;
+        while (in >> ns)
+        {
+            perFrame.push_back(real64(ns));
+            totalNs += ns;
+        }
+    }
+    std::filesystem::remove(times);
+    if (perFrame.empty())
+    {
+        ret.error = "The game wrote no frame times to " + times + ".";
+        return ret;
+    }
+    AddResult(size, "render", mines, perFrame, totalNs, perFrame.size());
+    
+    ret.result = true;
+    return ret;
+}
+#endif
+
+static ResultBool WriteJson(const std::string& path, uint64 seed)
+{
+    ResultBool ret = {false, ""};
+    
+    std::ofstream out(path, std::ios::trunc);
+    if (!out)
+    {
+        ret.error = "Failed to open " + path + " for writing.";
+        return ret;
+    }
+    
+    char line[320];
+    out << "{\"seed\":" << seed << ",\"results\":[";
+    for (MemoryIndex i = 0; i < g_results.size(); i++)
+    {
+        const BenchResult& b = g_results[i];
+        std::snprintf(line, sizeof(line), "%s\n{\"name\":\"%s\",\"rows\":%u,\"cols\":%u,\"mines\":%u,\"iterations\":%" PRIu64 ","
+                      "\"ops\":%.1f,\"ns_per_op\":%.4f,\"min_ns_per_op\":%.4f,\"mean_ns_per_op\":%.4f}",
+                      (i ? "," : ""), b.name.c_str(), b.size->rows, b.size->cols, b.mines, b.iterations, b.ops, b.medianNs, b.minNs, b.meanNs);
+        out << line;
+    }
+    out << "\n]}\n";
+    
+    if (!out)
+    {
+        ret.error = "Failed to write " + path + ".";
+        return ret;
+    }
+    
+    ret.result = true;
+    return ret;
+}
+
+// Reads the fastest time per operation of every case in a file written by WriteJson.
+static ResultBool ReadBaseline(const std::string& path, std::map<std::string, real64>& baseline)
+{
+    ResultBool ret = {false, ""};
+    
+    std::ifstream in(path);
+    if (!in)
+    {
+        ret.error = "Failed to open baseline: " + path;
+        return ret;
+    }
+    
+    std::string line;
+    while (std::getline(in, line))
+    {
+        const std::string nameKey = "\"name\":\"";
+        const std::string nsKey = "\"min_ns_per_op\":";
+        MemoryIndex name = line.find(nameKey);
+        MemoryIndex ns = line.find(nsKey);
+        if (name == std::string::npos || ns == std::string::npos)
+            continue;
+        
+        name += nameKey.size();
+        MemoryIndex nameEnd = line.find('"', name);
+        std::istringstream value(line.substr(ns + nsKey.size()));
+        real64 v = 0;
+        if (nameEnd == std::string::npos || !(value >> v))
+        {
+            ret.error = "Baseline " + path + " has a malformed result: " + line;
+            return ret;
+        }
+        baseline[line.substr(name, nameEnd - name)] = v;
+    }
+    if (baseline.empty())
+    {
+        ret.error = "Baseline " + path + " has no results.";
+        return ret;
+    }
+    
+    ret.result = true;
+    return ret;
+}
+
+// Prints every case against the baseline; false if any is slower by more than threshold percent.
+static bool CompareBaseline(const std::map<std::string, real64>& baseline, uint32 threshold)
+{
+    uint32 regressions = 0;
+    std::printf("Against the baseline (fastest ns/op): case baseline now change\n");
+    for (const BenchResult& b : g_results)
+    {
+        auto found = baseline.find(b.name);
+        if (found == baseline.end())
+        {
+            std::printf("    %-24s %12s %12.3f\n", b.name.c_str(), "-", b.minNs);
+            continue;
+        }
+        
+        real64 change = (found->second > 0 ? 100.0 * (b.minNs / found->second - 1.0) : 0.0);
+        bool regressed = change > threshold;
+        regressions += regressed;
+        std::printf("    %-24s %12.3f %12.3f %+7.1f%%%s\n", b.name.c_str(), found->second, b.minNs, change, (regressed ? "  REGRESSION" : ""));
+    }
+    
+    if (regressions)
+        std::printf("%u cases are more than %u%% slower than the baseline.\n", regressions, threshold);
+    return regressions == 0;
+}
+
+int main(int argc, char* argv[])
+{
+    uint64 seed = 1;
+    std::string jsonFile;
+    std::string baselineFile;
+    uint32 threshold = BENCH_DEFAULT_THRESHOLD;
+    
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        uint32 ms = 0;
+        if (arg == "--seed" && i + 1 < argc && ParseUint64(argv[i+1], seed))
+        {
+            i++;
+        }
+        else if (arg == "--filter" && i + 1 < argc)
+        {
+            g_filter = argv[++i];
+        }
+        else if (arg == "--min-time" && i + 1 < argc && ParseUint32(argv[i+1], ms))
+        {
+            g_minTimeNs = uint64(ms) * 1000000;
+            i++;
+        }
+        else if (arg == "--json" && i + 1 < argc)
+        {
+            jsonFile = argv[++i];
+        }
+        else if (arg == "--baseline" && i + 1 < argc)
+        {
+            baselineFile = argv[++i];
+        }
+        else if (arg == "--threshold" && i + 1 < argc && ParseUint32(argv[i+1], threshold))
+        {
+            i++;
+        }
+        else
+        {
+            LOG_FAIL("Unknown argument: %s", arg.c_str());
+            std::printf("Usage: minesweeper_bench [--seed <n>] [--filter <text>] [--min-time <ms>] [--json <file>]"
+                        " [--baseline <file> [--threshold <percent>]]\n");
+            return 1;
+        }
+    }
+    
+    // Read the baseline first so a bad path fails before minutes of benchmarks.
+    std::map<std::string, real64> baseline;
+    if (!baselineFile.empty())
+    {
+        ResultBool baselineRead = ReadBaseline(baselineFile, baseline);
+        if (!baselineRead)
+        {
+            LOG_FAIL("%s", baselineRead.error.c_str());
+            return 1;
+        }
+    }
+    
+    for (const BenchSize& size : BENCH_SIZES)
+    {
+        RunSize(size, seed);
+#if defined(BENCH_GAME_PATH)
+        ResultBool render = RunRender(size, seed);
+        if (!render)
+        {
+            LOG_FAIL("%s", render.error.c_str());
+            return 1;
+        }
+#endif
+    }
+    if (g_results.empty())
+    {
+        LOG_FAIL("No case matches the filter: %s", g_filter.c_str());
+        return 1;
+    }
+    
+    if (!jsonFile.empty())
+    {
+        ResultBool jsonWrite = WriteJson(jsonFile, seed);
+        if (!jsonWrite)
+        {
+            LOG_FAIL("%s", jsonWrite.error.c_str());
+            return 1;
+        }
+    }
+    if (!baselineFile.empty() && !CompareBaseline(baseline, threshold))
+        return 1;
+    return 0;
+}
@@ -0,0 +1,711 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+#include "board.h"
+#include "random.h"
+
+#include <algorithm> // fill, min
+#include <sstream>
+
+
+ResultBool Board::Init(uint32 rows, uint32 cols, uint32 mines)
+{
+    ResultBool ret = {false, ""};
+    
+    if (rows < BOARD_MIN_SIZE || cols < BOARD_MIN_SIZE || rows > BOARD_MAX_SIZE || cols > BOARD_MAX_SIZE)
+    {
+        std::stringstream ss;
+        ss << "Board size " << rows << "x" << cols << " is outside of "
+           << BOARD_MIN_SIZE << "x" << BOARD_MIN_SIZE << " to " << BOARD_MAX_SIZE << "x" << BOARD_MAX_SIZE << ".";
+        ret.error = ss.str();
+        return ret;
+    }
+    
+    // Leave at least one cell free so the board can be won.
+    if (mines == 0 || mines >= rows * cols)
+    {
+        std::stringstream ss;
+        ss << "Mine count " << mines << " must be between 1 and " << (rows * cols - 1) << ".";
+        ret.error = ss.str();
+        return ret;
+    }
+    
+    m_rows = rows;
+    m_cols = cols;
+    m_mines = mines;
+    m_stride = (cols + 63) / 64;
+    m_nearbyStride = m_stride * 64;
+    m_shape = BOARD_SHAPE_GENERIC;
+#ifndef BOARD_GENERIC_ONLY
+    if (rows == GAME_MODE_BEGINNER.rows && cols == GAME_MODE_BEGINNER.cols)
+        m_shape = BOARD_SHAPE_BEGINNER;
+    else if (rows == GAME_MODE_INTERMEDIATE.rows && cols == GAME_MODE_INTERMEDIATE.cols)
+        m_shape = BOARD_SHAPE_INTERMEDIATE;
+    else if (rows == GAME_MODE_EXPERT.rows && cols == GAME_MODE_EXPERT.cols)
+        m_shape = BOARD_SHAPE_EXPERT;
+#endif
+    m_exploded = BOARD_NO_CELL;
+    m_revealed = 0;
+    m_state = GAME_PLAYING;
+    m_bits.assign(MemorySize(PLANE_COUNT) * rows * m_stride, 0);
+    m_nearby.assign(MemorySize(rows) * m_nearbyStride, 0);
+    // Flood fills append to m_changed; reserve enough for typical openings so play does not allocate.
+    m_changed.clear();
+    m_changed.reserve(std::min<MemorySize>(CellCount(), BOARD_CHANGED_RESERVE));
+    m_flood.clear();
+    m_flood.reserve(std::min<MemorySize>(MemorySize(rows) * m_stride, BOARD_CHANGED_RESERVE));
+    
+    ret.result = true;
+    return ret;
+}
+
+void Board::Clear()
+{
+    std::fill(m_bits.begin(), m_bits.end(), 0);
+    std::fill(m_nearby.begin(), m_nearby.end(), 0);
+    m_exploded = BOARD_NO_CELL;
+    m_revealed = 0;
+    m_state = GAME_PLAYING;
+    m_changed.clear();
+}
+
+/*
+    Floyd's sampling picks exactly Mines() distinct cells in O(mines) draws: for each j in
+    [cells - mines, cells) take a random cell in [0, j], or j itself if that one is already a mine.
+    The mine plane doubles as the "already chosen" set so no extra memory is needed.
+*/
+void Board::Generate(uint64 seed)
+{
+    Clear();
+    m_seed = seed;
+    
+    Random rng(seed);
+    uint32 cells = CellCount();
+    for (uint32 j = cells - m_mines; j < cells; j++)
+    {
+        uint32 t = rng.Below(j + 1);
+        if (IsMine(t / m_cols, t % m_cols))
+            t = j;
+        SetMine(t / m_cols, t % m_cols, true);
+    }
+    
+    CountNeighbors();
+}
+
+ResultBool Board::Restore(uint64 seed, uint32 exploded)
+{
+    ResultBool ret = {false, ""};
+    
+    uint64 mines = 0;
+    uint64 revealed = 0;
+    uint64 lastMask = ((m_cols & 63) ? (uint64(1) << (m_cols & 63)) - 1 : ~uint64(0));
+    for (uint32 r = 0; r < m_rows; r++)
+    {
+        const uint64* mine = Row(PLANE_MINE, r);
+        const uint64* rev = Row(PLANE_REVEALED, r);
+        const uint64* flag = Row(PLANE_FLAGGED, r);
+        const uint64* guess = Row(PLANE_GUESSED, r);
+        for (uint32 w = 0; w < m_stride; w++)
+        {
+            uint64 any = mine[w] | rev[w] | flag[w] | guess[w];
+            if ((w + 1 == m_stride && (any & ~lastMask)) || (mine[w] & rev[w]) || (rev[w] & (flag[w] | guess[w])) || (flag[w] & guess[w]))
+            {
+                ret.error = "Board planes are inconsistent in row " + std::to_string(r) + ".";
+                return ret;
+            }
+            mines += PopCount64(mine[w]);
+            revealed += PopCount64(rev[w]);
+        }
+    }
+    if (mines != m_mines || (exploded != BOARD_NO_CELL && (exploded >= CellCount() || !IsMine(exploded / m_cols, exploded % m_cols))))
+    {
+        ret.error = "Board mines do not match its mine count.";
+        return ret;
+    }
+    
+    m_seed = seed;
+    m_exploded = exploded;
+    m_revealed = uint32(revealed);
+    m_state = (exploded != BOARD_NO_CELL ? GAME_LOST : (m_revealed == CellCount() - m_mines ? GAME_WON : GAME_PLAYING));
+    m_changed.clear();
+    CountNeighbors();
+    
+    ret.result = true;
+    return ret;
+}
+
+/*
+    The first reveal is always safe: mines in the 3x3 area around it move to random cells outside the area, so the
+    game opens on a number or an empty region. When too few cells are free outside the area only the clicked cell
+    is cleared. The new places are drawn from the board's seed and the clicked cell, so a replayed game makes the
+    same moves. Each move updates the counts of the 18 cells around its two ends instead of recounting the board.
+*/
+void Board::ClearOpening(uint32 r, uint32 c)
+{
+    uint32 r0 = (r > 0 ? r - 1 : 0);
+    uint32 r1 = std::min(r + 1, m_rows - 1);
+    uint32 c0 = (c > 0 ? c - 1 : 0);
+    uint32 c1 = std::min(c + 1, m_cols - 1);
+    uint32 areaCells = (r1 - r0 + 1) * (c1 - c0 + 1);
+    uint32 areaMines = 0;
+    for (uint32 ar = r0; ar <= r1; ar++)
+    {
+        for (uint32 ac = c0; ac <= c1; ac++)
+            areaMines += IsMine(ar, ac);
+    }
+    if (CellCount() - m_mines - (areaCells - areaMines) < areaMines)
+    {
+        r0 = r1 = r;
+        c0 = c1 = c;
+        areaMines = IsMine(r, c);
+    }
+    if (areaMines == 0)
+        return;
+    
+    Random rng(m_seed ^ (uint64(Index(r, c)) * 0x9E3779B97F4A7C15ULL));
+    for (uint32 ar = r0; ar <= r1; ar++)
+    {
+        for (uint32 ac = c0; ac <= c1; ac++)
+        {
+            if (!IsMine(ar, ac))
+                continue;
+            
+            // A few random draws nearly always land on a free cell; on very dense boards fall back to the next
+            // free cell after the last draw. There is at least one, as checked above.
+            uint32 t = rng.Below(CellCount());
+            for (uint32 tries = 0; ; tries++)
+            {
+                uint32 tr = t / m_cols;
+                uint32 tc = t % m_cols;
+                bool inArea = tr >= r0 && tr <= r1 && tc >= c0 && tc <= c1;
+                if (!inArea && !IsMine(tr, tc))
+                    break;
+                t = (tries < 32 ? rng.Below(CellCount()) : (t + 1) % CellCount());
+            }
+            MoveMine(ar, ac, t / m_cols, t % m_cols);
+        }
+    }
+}
+
+void Board::MoveMine(uint32 fromR, uint32 fromC, uint32 toR, uint32 toC)
+{
+    SetMine(fromR, fromC, false);
+    SetMine(toR, toC, true);
+    UpdateNearby(fromR, fromC, -1);
+    UpdateNearby(toR, toC, 1);
+}
+
+void Board::UpdateNearby(uint32 r, uint32 c, int32 delta)
+{
+    for (int32 dr = -1; dr <= 1; dr++)
+    {
+        for (int32 dc = -1; dc <= 1; dc++)
+        {
+            if (!InBounds(int64(r) + dr, int64(c) + dc))
+                continue;
+            
+            uint32 nr = r + dr;
+            uint32 nc = c + dc;
+            uint8& count = m_nearby[MemoryIndex(nr) * m_nearbyStride + nc];
+            if (dr || dc)
+                count = uint8(count + delta);
+            Set(PLANE_EMPTY, nr, nc, count == 0 && !IsMine(nr, nc));
+        }
+    }
+}
+
+MoveResult Board::RevealCell(uint32 r, uint32 c)
+{
+    if (IsRevealed(r, c) || IsFlagged(r, c))
+        return MOVE_NONE;
+    
+    if (IsMine(r, c))
+    {
+        SetExploded(r, c);
+        m_changed.push_back(Index(r, c));
+        m_state = GAME_LOST;
+        return MOVE_EXPLODED;
+    }
+    
+    SetRevealed(r, c, true);
+    SetGuessed(r, c, false);
+    m_changed.push_back(Index(r, c));
+    m_revealed++;
+    if (m_revealed == CellCount() - m_mines)
+        m_state = GAME_WON;
+    return MOVE_REVEALED;
+}
+
+uint64 Board::RevealSafeWord(uint32 r, uint32 w, uint64 mask)
+{
+    // Bits past the last column are padding and must stay zero.
+    if (w + 1 == m_stride && (m_cols & 63))
+        mask &= (uint64(1) << (m_cols & 63)) - 1;
+    
+    uint64& revealed = m_bits[WordIndex(PLANE_REVEALED, r, w * 64)];
+    uint64 bits = mask & ~revealed & ~m_bits[WordIndex(PLANE_FLAGGED, r, w * 64)];
+    if (!bits)
+        return 0;
+    
+    revealed |= bits;
+    m_bits[WordIndex(PLANE_GUESSED, r, w * 64)] &= ~bits;
+    m_revealed += PopCount64(bits);
+    
+    uint32 base = r * m_cols + w * 64;
+    for (uint64 b = bits; b; b &= b - 1)
+        m_changed.push_back(base + CountTrailingZeros64(b));
+    return bits & m_bits[WordIndex(PLANE_EMPTY, r, w * 64)];
+}
+
+void Board::RevealSafeWordAndQueue(uint32 r, uint32 w, uint64 mask)
+{
+    uint64 empty = RevealSafeWord(r, w, mask);
+    if (empty)
+        m_flood.push_back({r, w, empty});
+}
+
+/*
+    Scanline flood fill without recursion, 64 cells at a time. Each stack item is a set of newly revealed
+    empty cells in one row word; it is first grown along the row through every empty cell of that word,
+    then widened by one column and revealed in the rows above, at and below, spilling one bit into the
+    words on either side. Neighbors of an empty cell are never mines, so they are revealed with plain masks
+    and only new empty cells outside the item's own run are pushed. Every cell is revealed once.
+    Only called after a move that revealed cells without exploding.
+*/
+void Board::FloodGeneric(MemoryIndex first)
+{
+    m_flood.clear();
+    for (MemoryIndex i = first; i < m_changed.size(); i++)
+    {
+        uint32 r = m_changed[i] / m_cols;
+        uint32 c = m_changed[i] % m_cols;
+        if (Get(PLANE_EMPTY, r, c))
+            m_flood.push_back({r, c >> 6, uint64(1) << (c & 63)});
+    }
+    
+    while (!m_flood.empty())
+    {
+        FloodItem item = m_flood.back();
+        m_flood.pop_back();
+        
+        // Flagged cells stay covered, so they end a run.
+        uint64 runs = m_bits[WordIndex(PLANE_EMPTY, item.r, item.w * 64)] & ~m_bits[WordIndex(PLANE_FLAGGED, item.r, item.w * 64)];
+        uint64 run = FillRuns(item.bits, runs);
+        uint64 wide = run | (run << 1) | (run >> 1);
+        bool spillLeft = item.w > 0 && (run & 1);
+        bool spillRight = item.w + 1 < m_stride && (run >> 63);
+        
+        // The run itself needs no queueing: its neighbors are all handled here.
+        RevealSafeWord(item.r, item.w, wide);
+        if (item.r > 0)
+            RevealSafeWordAndQueue(item.r - 1, item.w, wide);
+        if (item.r + 1 < m_rows)
+            RevealSafeWordAndQueue(item.r + 1, item.w, wide);
+        
+        uint32 r0 = (item.r > 0 ? item.r - 1 : 0);
+        uint32 r1 = (item.r + 1 < m_rows ? item.r + 1 : item.r);
+        for (uint32 r = r0; r <= r1; r++)
+        {
+            if (spillLeft)
+                RevealSafeWordAndQueue(r, item.w - 1, uint64(1) << 63);
+            if (spillRight)
+                RevealSafeWordAndQueue(r, item.w + 1, 1);
+        }
+    }
+    
+    if (m_revealed == CellCount() - m_mines)
+        m_state = GAME_WON;
+}
+
+void Board::Flood(MemoryIndex first)
+{
+    if (m_shape == BOARD_SHAPE_BEGINNER)
+        FloodFixed<GAME_MODE_BEGINNER.rows, GAME_MODE_BEGINNER.cols>(first);
+    else if (m_shape == BOARD_SHAPE_INTERMEDIATE)
+        FloodFixed<GAME_MODE_INTERMEDIATE.rows, GAME_MODE_INTERMEDIATE.cols>(first);
+    else if (m_shape == BOARD_SHAPE_EXPERT)
+        FloodFixed<GAME_MODE_EXPERT.rows, GAME_MODE_EXPERT.cols>(first);
+    else
+        FloodGeneric(first);
+}
+
+MoveResult Board::Reveal(uint32 r, uint32 c)
+{
+    m_changed.clear();
+    if (m_state != GAME_PLAYING)
+        return MOVE_NONE;
+    
+    if (m_revealed == 0 && !IsFlagged(r, c))
+        ClearOpening(r, c);
+    MoveResult result = RevealCell(r, c);
+    if (result == MOVE_REVEALED)
+        Flood(0);
+    return result;
+}
+
+MoveResult Board::Chord(uint32 r, uint32 c)
+{
+    m_changed.clear();
+    if (m_state != GAME_PLAYING || !IsRevealed(r, c))
+        return MOVE_NONE;
+    
+    if (m_shape == BOARD_SHAPE_BEGINNER)
+        return ChordFixed<GAME_MODE_BEGINNER.rows, GAME_MODE_BEGINNER.cols>(r, c);
+    else if (m_shape == BOARD_SHAPE_INTERMEDIATE)
+        return ChordFixed<GAME_MODE_INTERMEDIATE.rows, GAME_MODE_INTERMEDIATE.cols>(r, c);
+    else if (m_shape == BOARD_SHAPE_EXPERT)
+        return ChordFixed<GAME_MODE_EXPERT.rows, GAME_MODE_EXPERT.cols>(r, c);
+    else
+        return ChordGeneric(r, c);
+}
+
+MoveResult Board::ChordGeneric(uint32 r, uint32 c)
+{
+    uint32 flags = 0;
+    for (int32 dr = -1; dr <= 1; dr++)
+    {
+        for (int32 dc = -1; dc <= 1; dc++)
+        {
+            if ((dr || dc) && InBounds(int64(r) + dr, int64(c) + dc) && IsFlagged(r + dr, c + dc))
+                flags++;
+        }
+    }
+    if (flags != MinesNearby(r, c))
+        return MOVE_NONE;
+    
+    MoveResult result = MOVE_NONE;
+    for (int32 dr = -1; dr <= 1; dr++)
+    {
+        for (int32 dc = -1; dc <= 1; dc++)
+        {
+            if (!(dr || dc) || !InBounds(int64(r) + dr, int64(c) + dc))
+                continue;
+            
+            MoveResult m = RevealCell(r + dr, c + dc);
+            if (m == MOVE_EXPLODED)
+                return m;
+            if (m == MOVE_REVEALED)
+                result = m;
+        }
+    }
+    if (result == MOVE_REVEALED)
+        Flood(0);
+    return result;
+}
+
+void Board::CycleMark(uint32 r, uint32 c)
+{
+    m_changed.clear();
+    if (m_state != GAME_PLAYING || IsRevealed(r, c))
+        return;
+    
+    m_changed.push_back(Index(r, c));
+    if (IsFlagged(r, c))
+    {
+        SetFlagged(r, c, false); SetGuessed(r, c, true);
+    }
+    else if (IsGuessed(r, c))
+    {
+        SetFlagged(r, c, false); SetGuessed(r, c, false);
+    }
+    else
+    {
+        SetFlagged(r, c, true); SetGuessed(r, c, false);
+    }
+}
+
+void Board::CountNeighbors()
+{
+    if (m_shape == BOARD_SHAPE_BEGINNER)
+        CountNeighborsFixed<GAME_MODE_BEGINNER.rows, GAME_MODE_BEGINNER.cols>();
+    else if (m_shape == BOARD_SHAPE_INTERMEDIATE)
+        CountNeighborsFixed<GAME_MODE_INTERMEDIATE.rows, GAME_MODE_INTERMEDIATE.cols>();
+    else if (m_shape == BOARD_SHAPE_EXPERT)
+        CountNeighborsFixed<GAME_MODE_EXPERT.rows, GAME_MODE_EXPERT.cols>();
+    else
+    {
+        for (uint32 r = 0; r < m_rows; r++)
+            CountNeighborsRow(r);
+    }
+}
+
+void Board::CountNeighborsRow(uint32 r)
+{
+#ifdef BOARD_SCALAR_COUNTS
+    CountNeighborsRowScalar(r);
+#else
+    CountNeighborsRowBitboard(r);
+#endif
+}
+
+void Board::CountNeighborsRowScalar(uint32 r)
+{
+    uint8* out = &m_nearby[MemoryIndex(r) * m_nearbyStride];
+    for (uint32 c = 0; c < m_cols; c++)
+    {
+        uint8 count = 0;
+        for (int32 dr = -1; dr <= 1; dr++)
+        {
+            for (int32 dc = -1; dc <= 1; dc++)
+            {
+                if ((dr || dc) && InBounds(int64(r) + dr, int64(c) + dc) && IsMine(r + dr, c + dc))
+                    count++;
+            }
+        }
+        out[c] = count;
+        Set(PLANE_EMPTY, r, c, count == 0 && !IsMine(r, c));
+    }
+}
+
+// Spreads the 8 bits of the index into the low bit of each of 8 bytes.
+struct SpreadTable
+{
+    uint64 bytes[256];
+    
+    SpreadTable()
+    {
+        for (uint32 i = 0; i < 256; i++)
+        {
+            bytes[i] = 0;
+            for (uint32 b = 0; b < 8; b++)
+            {
+                if (i & (1 << b))
+                    bytes[i] |= uint64(1) << (b * 8);
+            }
+        }
+    }
+};
+
+static const SpreadTable g_spread;
+
+/*
+    Counts 64 cells per step with bit-sliced adds on shifted rows:
+        col = above + self + below for every column (2 bits),
+        mid = above + below for the cell's own column (2 bits),
+        count = col shifted left + mid + col shifted right (4 bits, at most 8).
+    The four count bits are then spread into one byte per cell through a lookup table.
+*/
+void Board::CountNeighborsRowBitboard(uint32 r)
+{
+    static const uint64 none[BOARD_MAX_SIZE / 64 + 1] = {};
+    const uint64* up = (r > 0 ? Row(PLANE_MINE, r - 1) : none);
+    const uint64* self = Row(PLANE_MINE, r);
+    const uint64* down = (r + 1 < m_rows ? Row(PLANE_MINE, r + 1) : none);
+    uint8* out = &m_nearby[MemoryIndex(r) * m_nearbyStride];
+    uint64* empty = Row(PLANE_EMPTY, r);
+    
+    // Column sums for the previous, current and next word.
+    uint64 prev0 = 0;
+    uint64 prev1 = 0;
+    uint64 cur0 = up[0] ^ self[0] ^ down[0];
+    uint64 cur1 = (up[0] & self[0]) | (down[0] & (up[0] ^ self[0]));
+    for (uint32 w = 0; w < m_stride; w++)
+    {
+        uint64 next0 = 0;
+        uint64 next1 = 0;
+        if (w + 1 < m_stride)
+        {
+            next0 = up[w+1] ^ self[w+1] ^ down[w+1];
+            next1 = (up[w+1] & self[w+1]) | (down[w+1] & (up[w+1] ^ self[w+1]));
+        }
+        
+        // Bit i of a row word is column 64*w + i, so the left neighbor's sum shifts up a bit.
+        uint64 l0 = (cur0 << 1) | (prev0 >> 63);
+        uint64 l1 = (cur1 << 1) | (prev1 >> 63);
+        uint64 r0 = (cur0 >> 1) | (next0 << 63);
+        uint64 r1 = (cur1 >> 1) | (next1 << 63);
+        uint64 t[4];
+        AddNeighborSums(l0, l1, r0, r1, up[w] ^ down[w], up[w] & down[w], t);
+        
+        empty[w] = ~(t[0] | t[1] | t[2] | t[3] | self[w]);
+        if (w + 1 == m_stride && (m_cols & 63))
+            empty[w] &= (uint64(1) << (m_cols & 63)) - 1;
+        
+        for (uint32 b = 0; b < 8; b++)
+        {
+            uint32 shift = b * 8;
+            uint64 counts = g_spread.bytes[(t[0] >> shift) & 0xFF]
+                          | (g_spread.bytes[(t[1] >> shift) & 0xFF] << 1)
+                          | (g_spread.bytes[(t[2] >> shift) & 0xFF] << 2)
+                          | (g_spread.bytes[(t[3] >> shift) & 0xFF] << 3);
+            std::memcpy(out + w * 64 + shift, &counts, sizeof(counts));
+        }
+        
+        prev0 = cur0;
+        prev1 = cur1;
+        cur0 = next0;
+        cur1 = next1;
+    }
+}
+
+/*
+    The fixed kernels keep a copy of the rows they read in a local array with a zero row on either side, so the
+    first and last rows need no special case, and mask columns with a constant. Rows are single words, never
+    spilling into a neighboring word.
+*/
+template <uint32 ROWS, uint32 COLS>
+void Board::CountNeighborsFixed()
+{
+    static_assert(COLS < 64, "Fixed kernels need one word per row with a spare bit.");
+    constexpr uint64 colMask = (uint64(1) << COLS) - 1;
+    // Only the bytes holding real columns are spread; the rest of each row's counts are padding.
+    constexpr uint32 countWords = (COLS + 7) / 8;
+    
+    uint64 mine[ROWS + 2];
+    mine[0] = 0;
+    mine[ROWS + 1] = 0;
+    std::memcpy(mine + 1, Row(PLANE_MINE, 0), ROWS * sizeof(uint64));
+    uint64* empty = Row(PLANE_EMPTY, 0);
+    
+    for (uint32 r = 1; r <= ROWS; r++)
+    {
+        uint64 up = mine[r - 1];
+        uint64 self = mine[r];
+        uint64 down = mine[r + 1];
+        uint64 col0 = up ^ self ^ down;
+        uint64 col1 = (up & self) | (down & (up ^ self));
+        uint64 t[4];
+        AddNeighborSums(col0 << 1, col1 << 1, col0 >> 1, col1 >> 1, up ^ down, up & down, t);
+        empty[r - 1] = ~(t[0] | t[1] | t[2] | t[3] | self) & colMask;
+        
+        uint8* out = &m_nearby[MemoryIndex(r - 1) * 64];
+        for (uint32 b = 0; b < countWords; b++)
+        {
+            uint32 shift = b * 8;
+            uint64 counts = g_spread.bytes[(t[0] >> shift) & 0xFF]
+                          | (g_spread.bytes[(t[1] >> shift) & 0xFF] << 1)
+                          | (g_spread.bytes[(t[2] >> shift) & 0xFF] << 2)
+                          | (g_spread.bytes[(t[3] >> shift) & 0xFF] << 3);
+            std::memcpy(out + shift, &counts, sizeof(counts));
+        }
+    }
+}
+
+/*
+    Instead of a stack of runs the whole region is grown at once: a row's reached empty cells spread to the empty
+    cells next to the reached ones in the rows above and below that were still covered, then along their runs.
+    Sweeping down and back up until nothing changes settles most openings in one or two passes. The region plus
+    one cell around it is then revealed row by row. It reveals the same cells as FloodGeneric, so only the order
+    of the changed list differs.
+*/
+template <uint32 ROWS, uint32 COLS>
+void Board::FloodFixed(MemoryIndex first)
+{
+    constexpr uint64 colMask = (uint64(1) << COLS) - 1;
+    
+    uint64* revealed = Row(PLANE_REVEALED, 0);
+    uint64* guessed = Row(PLANE_GUESSED, 0);
+    const uint64* flagged = Row(PLANE_FLAGGED, 0);
+    const uint64* empty = Row(PLANE_EMPTY, 0);
+    
+    // Flagged cells stay covered, so they end a run.
+    uint64 runs[ROWS + 2];
+    uint64 fresh[ROWS + 2]; // Empty cells the flood may still reveal.
+    uint64 region[ROWS + 2] = {};
+    runs[0] = runs[ROWS + 1] = 0;
+    fresh[0] = fresh[ROWS + 1] = 0;
+    for (uint32 r = 0; r < ROWS; r++)
+    {
+        runs[r + 1] = empty[r] & ~flagged[r];
+        fresh[r + 1] = runs[r + 1] & ~revealed[r];
+    }
+    
+    bool any = false;
+    for (MemoryIndex i = first; i < m_changed.size(); i++)
+    {
+        uint32 r = m_changed[i] / COLS;
+        uint32 c = m_changed[i] % COLS;
+        uint64 bit = (empty[r] >> c) & 1;
+        if (bit)
+        {
+            region[r + 1] = FillRuns(region[r + 1] | (bit << c), runs[r + 1]);
+            any = true;
+        }
+    }
+    
+    if (any)
+    {
+        auto grow = [&](uint32 r)
+        {
+            uint64 near = region[r - 1] | region[r + 1];
+            uint64 seeds = region[r] | ((near | (near << 1) | (near >> 1)) & fresh[r]);
+            if (seeds == region[r])
+                return false;
+            region[r] = FillRuns(seeds, runs[r]);
+            return true;
+        };
+        for (bool grew = true; grew; )
+        {
+            grew = false;
+            for (uint32 r = 1; r <= ROWS; r++)
+                grew |= grow(r);
+            for (uint32 r = ROWS; r >= 1; r--)
+                grew |= grow(r);
+        }
+        
+        for (uint32 r = 1; r <= ROWS; r++)
+        {
+            uint64 near = region[r - 1] | region[r] | region[r + 1];
+            uint64 bits = (near | (near << 1) | (near >> 1)) & colMask & ~revealed[r - 1] & ~flagged[r - 1];
+            if (!bits)
+                continue;
+            
+            revealed[r - 1] |= bits;
+            guessed[r - 1] &= ~bits;
+            m_revealed += PopCount64(bits);
+            uint32 base = (r - 1) * COLS;
+            for (uint64 b = bits; b; b &= b - 1)
+                m_changed.push_back(base + CountTrailingZeros64(b));
+        }
+    }
+    
+    if (m_revealed == CellCount() - m_mines)
+        m_state = GAME_WON;
+}
+
+/*
+    Flags are counted and neighbors revealed with one mask per row of the 3x3 area. When a neighbor is a mine
+    the cells before it in reading order are still revealed, as a chord one cell at a time would.
+*/
+template <uint32 ROWS, uint32 COLS>
+MoveResult Board::ChordFixed(uint32 r, uint32 c)
+{
+    constexpr uint64 colMask = (uint64(1) << COLS) - 1;
+    
+    uint64 around = (c > 0 ? uint64(7) << (c - 1) : 3) & colMask;
+    uint64 sides = around & ~(uint64(1) << c);
+    uint32 r0 = (r > 0 ? r - 1 : r);
+    uint32 r1 = (r + 1 < ROWS ? r + 1 : r);
+    const uint64* mine = Row(PLANE_MINE, 0);
+    const uint64* revealed = Row(PLANE_REVEALED, 0);
+    const uint64* flagged = Row(PLANE_FLAGGED, 0);
+    
+    uint32 flags = 0;
+    for (uint32 nr = r0; nr <= r1; nr++)
+        flags += PopCount64(flagged[nr] & (nr == r ? sides : around));
+    if (flags != MinesNearby(r, c))
+        return MOVE_NONE;
+    
+    bool any = false;
+    for (uint32 nr = r0; nr <= r1; nr++)
+    {
+        uint64 covered = (nr == r ? sides : around) & ~revealed[nr] & ~flagged[nr];
+        uint64 hit = covered & mine[nr];
+        if (hit)
+        {
+            RevealSafeWord(nr, 0, covered & ((hit & (~hit + 1)) - 1));
+            return RevealCell(nr, CountTrailingZeros64(hit));
+        }
+        RevealSafeWord(nr, 0, covered);
+        any |= (covered != 0);
+    }
+    if (!any)
+        return MOVE_NONE;
+    
+    FloodFixed<ROWS, COLS>(0);
+    return MOVE_REVEALED;
+}
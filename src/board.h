@@ -0,0 +1,258 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+#ifndef BOARD_H
+#define BOARD_H
+
+#include "common.h"
+
+#include <vector>
+
+
+/*
+    Game modes:
+        Beginner: 10 mines @ 8x8, 9x9, or 10x10.
+        Intermediate: 40 mines @ 13x15 or 16x16.
+        Expert: 99 mines @ 16x30 or 30x16.
+*/
+
+struct GameMode
+{
+    const char* name;
+    uint32 rows;
+    uint32 cols;
+    uint32 mines;
+};
+
+constexpr GameMode GAME_MODE_BEGINNER = {"beginner", 9, 9, 10};
+constexpr GameMode GAME_MODE_INTERMEDIATE = {"intermediate", 16, 16, 40};
+constexpr GameMode GAME_MODE_EXPERT = {"expert", 16, 30, 99};
+
+#define BOARD_MIN_SIZE 8
+#define BOARD_MAX_SIZE 10000
+#define BOARD_NO_CELL UINT32_MAX
+// Entries of the changed list and flood stack reserved up front; bigger floods grow them once and keep the capacity.
+#define BOARD_CHANGED_RESERVE (1 << 20)
+
+// Uncomment to count neighbors one cell at a time instead of with the row-wide bitboard kernel.
+//#define BOARD_SCALAR_COUNTS
+// Uncomment to run the standard sizes through the generic kernels too, e.g. to compare the two.
+//#define BOARD_GENERIC_ONLY
+
+
+enum GameState
+{
+    GAME_PLAYING,
+    GAME_WON,
+    GAME_LOST
+};
+
+// What a reveal or chord did to the board.
+enum MoveResult
+{
+    MOVE_NONE, // Nothing changed: the cell was flagged, already revealed or the game is over.
+    MOVE_REVEALED, // At least one safe cell was revealed.
+    MOVE_EXPLODED // A mine was revealed and the game is lost.
+};
+
+// Sizes whose counting, flood and chord kernels are specialized at compile time; every other size is generic.
+enum BoardShape
+{
+    BOARD_SHAPE_GENERIC,
+    BOARD_SHAPE_BEGINNER,
+    BOARD_SHAPE_INTERMEDIATE,
+    BOARD_SHAPE_EXPERT
+};
+
+// One bit per cell per plane; each row is padded to a whole number of 64 bit words.
+enum BoardPlane
+{
+    PLANE_MINE,
+    PLANE_REVEALED,
+    PLANE_FLAGGED,
+    PLANE_GUESSED,
+    PLANE_EMPTY, // Not a mine and no neighboring mines; derived from the mine plane by CountNeighbors.
+    PLANE_COUNT
+};
+
+// Grows each set bit of seeds through the run of set bits of runs it sits in (Kogge-Stone, both directions).
+inline uint64 FillRuns(uint64 seeds, uint64 runs)
+{
+    uint64 up = seeds;
+    uint64 down = seeds;
+    uint64 pu = runs;
+    uint64 pd = runs;
+    for (uint32 shift = 1; shift < 64; shift *= 2)
+    {
+        up |= pu & (up << shift);
+        down |= pd & (down >> shift);
+        pu &= pu << shift;
+        pd &= pd >> shift;
+    }
+    return up | down;
+}
+
+/*
+    Bit-sliced neighbor counts of 64 cells in one row word. l and r are the 2 bit column sums (above + self + below)
+    of each cell's left and right column, m the 2 bit sum of the cells just above and below it.
+    Bit i of t[k] is bit k of cell i's count.
+*/
+inline void AddNeighborSums(uint64 l0, uint64 l1, uint64 r0, uint64 r1, uint64 m0, uint64 m1, uint64 t[4])
+{
+    // left + right
+    uint64 s0 = l0 ^ r0;
+    uint64 k0 = l0 & r0;
+    uint64 s1 = l1 ^ r1 ^ k0;
+    uint64 s2 = (l1 & r1) | (k0 & (l1 ^ r1));
+    
+    // + mid
+    uint64 c0 = s0 & m0;
+    uint64 c1 = (s1 & m1) | (c0 & (s1 ^ m1));
+    t[0] = s0 ^ m0;
+    t[1] = s1 ^ m1 ^ c0;
+    t[2] = s2 ^ c1;
+    t[3] = s2 & c1;
+}
+
+/*
+    A rows x cols board stored as bitplanes plus one byte per cell of neighboring mine counts.
+    Every plane and the counts live in contiguous allocations so whole rows can be processed at once.
+    Padding bits past the last column are always zero.
+*/
+class Board
+{
+public:
+    // Validates the dimensions and (re)allocates the planes; existing cells are cleared.
+    ResultBool Init(uint32 rows, uint32 cols, uint32 mines);
+    // Resets every cell to its default state without reallocating.
+    void Clear();
+    // Clears the board, places Mines() mines uniformly at random from seed and counts neighbors.
+    void Generate(uint64 seed);
+    // Rebuilds what is derived from the mine, revealed, flagged and guessed planes after they were written
+    // directly, e.g. by LoadBoard: neighbor counts, the revealed count and the game state.
+    // Fails if the planes are inconsistent: wrong mine count, revealed mines, marks on revealed cells or set padding bits.
+    ResultBool Restore(uint64 seed, uint32 exploded);
+    
+    uint32 Rows() const { return m_rows; }
+    uint32 Cols() const { return m_cols; }
+    uint32 Mines() const { return m_mines; }
+    uint32 CellCount() const { return m_rows * m_cols; }
+    // Seed passed to the last Generate().
+    uint64 Seed() const { return m_seed; }
+    // Number of 64 bit words in one row of a plane.
+    uint32 Stride() const { return m_stride; }
+    // Which kernels the board runs, picked by Init from its size.
+    BoardShape Shape() const { return m_shape; }
+    
+    bool InBounds(int64 r, int64 c) const { return r >= 0 && c >= 0 && r < m_rows && c < m_cols; }
+    uint32 Index(uint32 r, uint32 c) const { return r * m_cols + c; }
+    
+    bool Get(BoardPlane p, uint32 r, uint32 c) const
+    {
+        assert(r < m_rows && c < m_cols);
+        return (m_bits[WordIndex(p, r, c)] >> (c & 63)) & 1;
+    }
+    
+    void Set(BoardPlane p, uint32 r, uint32 c, bool v)
+    {
+        assert(r < m_rows && c < m_cols);
+        uint64 bit = uint64(1) << (c & 63);
+        uint64& w = m_bits[WordIndex(p, r, c)];
+        w = (v ? (w | bit) : (w & ~bit));
+    }
+    
+    const uint64* Row(BoardPlane p, uint32 r) const { return &m_bits[(MemoryIndex(p) * m_rows + r) * m_stride]; }
+    uint64* Row(BoardPlane p, uint32 r) { return &m_bits[(MemoryIndex(p) * m_rows + r) * m_stride]; }
+    
+    bool IsMine(uint32 r, uint32 c) const { return Get(PLANE_MINE, r, c); }
+    bool IsRevealed(uint32 r, uint32 c) const { return Get(PLANE_REVEALED, r, c); }
+    bool IsFlagged(uint32 r, uint32 c) const { return Get(PLANE_FLAGGED, r, c); }
+    bool IsGuessed(uint32 r, uint32 c) const { return Get(PLANE_GUESSED, r, c); }
+    // Player clicked the mine and lost.
+    bool IsExploded(uint32 r, uint32 c) const { return m_exploded == Index(r, c); }
+    // Cell the game was lost on, or BOARD_NO_CELL.
+    uint32 Exploded() const { return m_exploded; }
+    uint8 MinesNearby(uint32 r, uint32 c) const { assert(r < m_rows && c < m_cols); return m_nearby[MemoryIndex(r) * m_nearbyStride + c]; }
+    
+    void SetMine(uint32 r, uint32 c, bool v) { Set(PLANE_MINE, r, c, v); }
+    void SetRevealed(uint32 r, uint32 c, bool v) { Set(PLANE_REVEALED, r, c, v); }
+    void SetFlagged(uint32 r, uint32 c, bool v) { Set(PLANE_FLAGGED, r, c, v); }
+    void SetGuessed(uint32 r, uint32 c, bool v) { Set(PLANE_GUESSED, r, c, v); }
+    void SetExploded(uint32 r, uint32 c) { m_exploded = Index(r, c); }
+    
+    GameState State() const { return m_state; }
+    // Number of safe cells revealed so far; the game is won when this reaches CellCount() - Mines().
+    uint32 RevealedCount() const { return m_revealed; }
+    
+    // Left-click: reveals a covered, unflagged cell, and if it has no neighboring mines the whole connected
+    // region of such cells plus its numbered border. The first reveal of a game never hits a mine (see ClearOpening).
+    MoveResult Reveal(uint32 r, uint32 c);
+    // Middle-click: on a revealed number with that many flags around it, reveals every other covered neighbor
+    // (flooding from any that have no neighboring mines).
+    MoveResult Chord(uint32 r, uint32 c);
+    // Right-click: cycles a covered cell through unmarked, flagged and guessed.
+    void CycleMark(uint32 r, uint32 c);
+    // Indices of the cells changed by the last Reveal, Chord or CycleMark.
+    const std::vector<uint32>& Changed() const { return m_changed; }
+    
+    // Recomputes the neighboring mine counts for every cell from the mine plane.
+    void CountNeighbors();
+    // Recomputes the neighboring mine counts for a single row.
+    void CountNeighborsRow(uint32 r);
+
+private:
+    MemoryIndex WordIndex(BoardPlane p, uint32 r, uint32 c) const { return (MemoryIndex(p) * m_rows + r) * m_stride + (c >> 6); }
+    
+    MoveResult RevealCell(uint32 r, uint32 c);
+    // Moves the mines around the first reveal elsewhere, adjusting only the counts around each move.
+    void ClearOpening(uint32 r, uint32 c);
+    void MoveMine(uint32 fromR, uint32 fromC, uint32 toR, uint32 toC);
+    // Adds delta to the counts of the neighbors of (r, c) and refreshes the empty bits of its 3x3 area.
+    void UpdateNearby(uint32 r, uint32 c, int32 delta);
+    // Empty cells whose neighbors still have to be revealed by Flood: 64 columns of one row at a time.
+    struct FloodItem
+    {
+        uint32 r;
+        uint32 w;
+        uint64 bits;
+    };
+    
+    // Reveals the covered, unflagged cells of mask in word w of row r; returns the empty ones among them.
+    uint64 RevealSafeWord(uint32 r, uint32 w, uint64 mask);
+    // As RevealSafeWord, but pushes the newly revealed empty cells onto the flood stack.
+    void RevealSafeWordAndQueue(uint32 r, uint32 w, uint64 mask);
+    // Cascades reveals from every empty cell in m_changed at or after first.
+    void Flood(MemoryIndex first);
+    void FloodGeneric(MemoryIndex first);
+    MoveResult ChordGeneric(uint32 r, uint32 c);
+    
+    void CountNeighborsRowScalar(uint32 r);
+    void CountNeighborsRowBitboard(uint32 r);
+    
+    // Kernels for the standard sizes. A row fits in one word, and ROWS and COLS are constants, so loops unroll
+    // and the edges are handled by zero rows and column masks instead of bounds checks.
+    template <uint32 ROWS, uint32 COLS> void CountNeighborsFixed();
+    template <uint32 ROWS, uint32 COLS> void FloodFixed(MemoryIndex first);
+    template <uint32 ROWS, uint32 COLS> MoveResult ChordFixed(uint32 r, uint32 c);
+    
+    uint32 m_rows = 0;
+    uint32 m_cols = 0;
+    uint32 m_mines = 0;
+    uint32 m_stride = 0;
+    uint32 m_nearbyStride = 0;
+    BoardShape m_shape = BOARD_SHAPE_GENERIC;
+    uint32 m_exploded = BOARD_NO_CELL;
+    uint64 m_seed = 0;
+    uint32 m_revealed = 0;
+    GameState m_state = GAME_PLAYING;
+    std::vector<uint32> m_changed;
+    std::vector<FloodItem> m_flood; // Stack for Flood, kept between moves.
+    std::vector<uint64> m_bits; // PLANE_COUNT planes of rows * stride words.
+    std::vector<uint8> m_nearby; // rows * nearbyStride counts, nearbyStride = stride * 64.
+};
+
+#endif
@@ -0,0 +1,187 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+#include "bundle.h"
+
+#if defined(OS_WINDOWS)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <fcntl.h> // open
+    #include <sys/mman.h> // mmap
+    #include <sys/stat.h> // fstat
+    #include <unistd.h> // close
+#endif
+#include <fstream>
+
+
+static uint64 AlignUp(uint64 v) { return (v + BUNDLE_ALIGN - 1) / BUNDLE_ALIGN * BUNDLE_ALIGN; }
+
+ResultBool WriteBundle(const std::string& path, std::vector<BundleItem>& items)
+{
+    ResultBool ret = {false, ""};
+    
+    BundleHeader header = {BUNDLE_MAGIC, BUNDLE_VERSION, uint32(items.size()), 0};
+    uint64 offset = AlignUp(sizeof(BundleHeader) + sizeof(BundleEntry) * items.size());
+    for (BundleItem& item : items)
+    {
+        item.entry.offset = offset;
+        item.entry.size = item.data.size();
+        offset = AlignUp(offset + item.data.size());
+    }
+    
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        ret.error = "Failed to open " + path + " for writing.";
+        return ret;
+    }
+    
+    static const char padding[BUNDLE_ALIGN] = {};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const BundleItem& item : items)
+        out.write(reinterpret_cast<const char*>(&item.entry), sizeof(item.entry));
+    uint64 written = sizeof(BundleHeader) + sizeof(BundleEntry) * items.size();
+    for (const BundleItem& item : items)
+    {
+        out.write(padding, std::streamsize(item.entry.offset - written));
+        out.write(reinterpret_cast<const char*>(item.data.data()), std::streamsize(item.data.size()));
+        written = item.entry.offset + item.entry.size;
+    }
+    out.write(padding, std::streamsize(AlignUp(written) - written));
+    
+    if (!out)
+    {
+        ret.error = "Failed to write " + path + ".";
+        return ret;
+    }
+    
+    ret.result = true;
+    return ret;
+}
+
+ResultBool Bundle::Open(const std::string& path)
+{
+    ResultBool ret = {false, ""};
+    Close();
+
+#if defined(OS_WINDOWS)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        ret.error = "Failed to open " + path + ".";
+        return ret;
+    }
+    m_file = file;
+    
+    LARGE_INTEGER size;
+    HANDLE mapping = nullptr;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        Close();
+        ret.error = "Failed to map " + path + ".";
+        return ret;
+    }
+    m_mapping = mapping;
+    m_data = static_cast<const uint8*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    m_size = MemorySize(size.QuadPart);
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        ret.error = "Failed to open " + path + ".";
+        return ret;
+    }
+    
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        data = mmap(nullptr, MemorySize(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps the file alive on its own.
+    close(fd);
+    if (data != MAP_FAILED)
+    {
+        m_data = static_cast<const uint8*>(data);
+        m_size = MemorySize(st.st_size);
+    }
+#endif
+
+    if (!m_data)
+    {
+        Close();
+        ret.error = "Failed to map " + path + ".";
+        return ret;
+    }
+    
+    const BundleHeader* header = reinterpret_cast<const BundleHeader*>(m_data);
+    if (m_size < sizeof(BundleHeader) || header->magic != BUNDLE_MAGIC || header->version != BUNDLE_VERSION
+        || (m_size - sizeof(BundleHeader)) / sizeof(BundleEntry) < header->entryCount)
+    {
+        Close();
+        ret.error = path + " is not a version " + std::to_string(BUNDLE_VERSION) + " bundle.";
+        return ret;
+    }
+    
+    const BundleEntry* entries = reinterpret_cast<const BundleEntry*>(header + 1);
+    for (uint32 i = 0; i < header->entryCount; i++)
+    {
+        const BundleEntry& entry = entries[i];
+        bool corrupt = (entry.offset > m_size || entry.size > m_size - entry.offset || entry.offset % BUNDLE_ALIGN != 0
+                        || entry.name[BUNDLE_NAME_SIZE - 1] != 0);
+        // The payload must hold everything its entry describes, since loaders read that much straight from the mapping.
+        if (entry.type == BUNDLE_IMAGE)
+            corrupt = corrupt || uint64(entry.width) * entry.height > entry.size / 4;
+        else if (entry.type == BUNDLE_AUDIO)
+            corrupt = corrupt || entry.height == 0 || entry.size % (sizeof(float) * entry.height) != 0;
+        if (corrupt)
+        {
+            Close();
+            ret.error = path + " has a corrupt entry.";
+            return ret;
+        }
+    }
+    
+    ret.result = true;
+    return ret;
+}
+
+void Bundle::Close()
+{
+#if defined(OS_WINDOWS)
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    if (m_mapping)
+        CloseHandle(m_mapping);
+    if (m_file)
+        CloseHandle(m_file);
+    m_mapping = nullptr;
+    m_file = nullptr;
+#else
+    if (m_data)
+        munmap(const_cast<uint8*>(m_data), m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
+
+const BundleEntry* Bundle::Find(const std::string& name, BundleType type) const
+{
+    if (!m_data)
+        return nullptr;
+    
+    // A handful of entries; a linear scan beats building an index.
+    const BundleHeader* header = reinterpret_cast<const BundleHeader*>(m_data);
+    const BundleEntry* entries = reinterpret_cast<const BundleEntry*>(header + 1);
+    for (uint32 i = 0; i < header->entryCount; i++)
+    {
+        if (entries[i].type == uint32(type) && name == entries[i].name)
+            return &entries[i];
+    }
+    return nullptr;
+}
@@ -0,0 +1,101 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+#ifndef BUNDLE_H
+#define BUNDLE_H
+
+#include "common.h"
+
+#include <string>
+#include <vector>
+
+
+/*
+    Asset bundle: every image and sound in one file, already converted to the formats the game uses,
+    so startup is one open and one mmap with no parsing or conversion.
+
+    Layout (little endian):
+        BundleHeader
+        BundleEntry[entryCount]
+        payloads, each starting on a BUNDLE_ALIGN boundary.
+    Images are SDL_PIXELFORMAT_ARGB8888 rows of width * 4 bytes.
+    Sounds are interleaved samples in the SDL audio format, frequency and channel count of their entry.
+    Written by minesweeper_packer (src/packer.cpp).
+*/
+
+#define BUNDLE_MAGIC 0x4E42534D // "MSBN"
+#define BUNDLE_VERSION 1
+#define BUNDLE_ALIGN 64
+#define BUNDLE_NAME_SIZE 32
+#define BUNDLE_FILE "data.bundle"
+// Sounds are packed as 32 bit float samples at the rate and channel count the game opens its audio device with.
+#define BUNDLE_AUDIO_FREQUENCY 48000
+#define BUNDLE_AUDIO_CHANNELS 2
+
+enum BundleType
+{
+    BUNDLE_IMAGE = 1,
+    BUNDLE_AUDIO = 2
+};
+
+struct BundleHeader
+{
+    uint32 magic;
+    uint32 version;
+    uint32 entryCount;
+    uint32 reserved;
+};
+
+struct BundleEntry
+{
+    char name[BUNDLE_NAME_SIZE]; // Source file name, e.g. "flag.bmp"; zero padded.
+    uint32 type;
+    uint32 width; // Image width, or audio frequency.
+    uint32 height; // Image height, or audio channel count.
+    uint32 format; // SDL pixel format, or SDL audio format.
+    uint64 offset; // From the start of the file.
+    uint64 size;
+};
+
+static_assert(sizeof(BundleHeader) == 16, "BundleHeader is written as is.");
+static_assert(sizeof(BundleEntry) == 64, "BundleEntry is written as is.");
+
+// One asset to write with WriteBundle.
+struct BundleItem
+{
+    BundleEntry entry; // name, type, width, height and format; offset and size are filled in when writing.
+    std::vector<uint8> data;
+};
+
+ResultBool WriteBundle(const std::string& path, std::vector<BundleItem>& items);
+
+// A read-only memory-mapped bundle; payloads point straight into the mapping and stay valid until Close.
+class Bundle
+{
+public:
+    ~Bundle() { Close(); }
+    
+    // Maps the file and validates the header, every entry's bounds and that each payload is as large as its entry says.
+    ResultBool Open(const std::string& path);
+    void Close();
+    bool IsOpen() const { return m_data != nullptr; }
+    
+    // Finds an entry by name and type; nullptr if the bundle is closed or has no such entry.
+    // Callers still check the format, dimensions or rate they need; a mismatch means the bundle is stale.
+    const BundleEntry* Find(const std::string& name, BundleType type) const;
+    const uint8* Data(const BundleEntry& entry) const { return m_data + entry.offset; }
+
+private:
+    const uint8* m_data = nullptr;
+    MemorySize m_size = 0;
+#if defined(OS_WINDOWS)
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#endif
+};
+
+#endif
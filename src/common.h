@@ -0,0 +1,132 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+#ifndef COMMON_H
+#define COMMON_H
+
+#if defined(_WIN32) || defined(_WIN64)
+    #define OS_WINDOWS 1
+#elif defined(__linux__)
+    #define OS_LINUX 1
+#else
+    #error Unknown OS.
+#endif
+
+#if defined(__clang__)
+    #define COMPILER_CLANG 1
+#elif defined(__GNUC__)
+    #define COMPILER_GCC 1
+#elif defined(__MINGW32__) || defined(__MINGW64__)
+    #define COMPILER_MINGW 1
+#elif defined(_MSC_VER)
+    #define COMPILER_VISUAL_C
+#else
+    #error Unknown Compiler.
+#endif
+
+#if defined(COMPILER_CLANG) || defined(COMPILER_GCC) || defined(COMPILER_MINGW)
+    #if defined(__i386__)
+        #define ARCH_X86
+    #elif defined(__x86_64__)
+        #define ARCH_X64
+    #else
+        #error Unknown CPU Architecture.
+    #endif
+#elif defined(COMPILER_VISUAL_C)
+    #if defined(_M_IX86)
+        #define ARCH_X86
+    #elif defined(_M_X64)
+        #define ARCH_X64
+    #else
+        #error Unknown CPU Architecture.
+    #endif
+#else
+    #error Unknown Compiler.
+#endif
+
+
+#if defined(COMPILER_VISUAL_C)
+    #include <intrin.h> // _BitScanForward64, _BitScanReverse64, __popcnt64
+#endif
+#include <cassert> // assert
+#include <cstddef> // (u)int(8/16/32/64)_t
+#include <cstdint> // size_t
+#include <cstring> // memset
+#include <iostream> // cout
+#include <string>  // string
+
+
+#define KIBIBYTES(v) ((v) * 1024LL)
+#define MEBIBYTES(v) (KIBIBYTES(v) * 1024LL)
+#define GIBIBYTES(v) (MEBIBYTES(v) * 1024LL)
+
+#define ARRAY_COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+#define ZERO_STRUCT(s) std::memset(&(s), 0, sizeof(s))
+
+
+typedef std::int8_t int8;
+typedef std::int16_t int16;
+typedef std::int32_t int32;
+typedef std::int64_t int64;
+
+typedef std::uint8_t uint8;
+typedef std::uint16_t uint16;
+typedef std::uint32_t uint32;
+typedef std::uint64_t uint64;
+
+typedef float real32;
+typedef double real64;
+
+typedef std::size_t MemoryIndex;
+typedef std::size_t MemorySize;
+
+
+// Index of the lowest set bit; v must not be 0.
+inline uint32 CountTrailingZeros64(uint64 v)
+{
+#if defined(COMPILER_VISUAL_C)
+    unsigned long i;
+    _BitScanForward64(&i, v);
+    return uint32(i);
+#else
+    return uint32(__builtin_ctzll(v));
+#endif
+}
+
+// Index of the highest set bit; v must not be 0.
+inline uint32 BitScanReverse64(uint64 v)
+{
+#if defined(COMPILER_VISUAL_C)
+    unsigned long i;
+    _BitScanReverse64(&i, v);
+    return uint32(i);
+#else
+    return 63 - uint32(__builtin_clzll(v));
+#endif
+}
+
+inline uint32 PopCount64(uint64 v)
+{
+#if defined(COMPILER_VISUAL_C)
+    return uint32(__popcnt64(v));
+#else
+    return uint32(__builtin_popcountll(v));
+#endif
+}
+
+
+struct ResultBool
+{
+    bool result;
+    std::string error;
+    
+    explicit operator bool() const { return result; }
+};
+
+
+#endif
@@ -0,0 +1,201 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+#include "generator.h"
+#include "batch.h"
+#include "log.h"
+
+#include <algorithm> // max
+#include <cstdio> // fprintf
+#include <utility> // swap
+
+
+static_assert((NO_GUESS_POOL_SLOTS & (NO_GUESS_POOL_SLOTS - 1)) == 0, "NO_GUESS_POOL_SLOTS must be a power of two.");
+
+ResultBool NoGuessGenerator::Start(uint32 rows, uint32 cols, uint32 mines, uint64 seed, uint32 threads)
+{
+    ResultBool ret = {false, ""};
+    Stop();
+    
+    // Workers size their boards the same way, so once this passes they cannot fail.
+    Board probe;
+    ResultBool probeInit = probe.Init(rows, cols, mines);
+    if (!probeInit)
+    {
+        ret.error = probeInit.error;
+        return ret;
+    }
+    
+    m_rows = rows;
+    m_cols = cols;
+    m_mines = mines;
+    m_seed = seed;
+    for (uint64 i = 0; i < NO_GUESS_POOL_SLOTS; i++)
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    m_head.store(0, std::memory_order_relaxed);
+    m_tail = 0;
+    m_nextAttempt.store(0, std::memory_order_relaxed);
+    m_attempts.store(0, std::memory_order_relaxed);
+    m_boards.store(0, std::memory_order_relaxed);
+    m_nanoseconds.store(0, std::memory_order_relaxed);
+    m_start = std::chrono::steady_clock::now();
+    
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency()) - 1;
+    threads = std::max(1u, threads);
+    m_threads = threads;
+    m_running.store(true, std::memory_order_release);
+    for (uint32 i = 0; i < threads; i++)
+        m_workers.emplace_back(&NoGuessGenerator::Work, this);
+    
+    ret.result = true;
+    return ret;
+}
+
+void NoGuessGenerator::Stop()
+{
+    if (m_workers.empty())
+        return;
+    
+    m_running.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+    }
+    m_spaceWake.notify_all();
+    for (std::thread& t : m_workers)
+        t.join();
+    m_workers.clear();
+}
+
+bool NoGuessGenerator::Take(Board& board, uint32 waitMs)
+{
+    if (m_workers.empty())
+        return false;
+    
+    Slot& slot = m_slots[m_tail & (NO_GUESS_POOL_SLOTS - 1)];
+    auto ready = [&]() { return slot.sequence.load(std::memory_order_acquire) == m_tail + 1; };
+    if (!ready())
+    {
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        if (!m_readyWake.wait_for(lock, std::chrono::milliseconds(waitMs), ready))
+            return false;
+    }
+    
+    std::swap(board, slot.board);
+    slot.sequence.store(m_tail + NO_GUESS_POOL_SLOTS, std::memory_order_release);
+    m_tail++;
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+    }
+    m_spaceWake.notify_one();
+    return true;
+}
+
+NoGuessStats NoGuessGenerator::Stats() const
+{
+    NoGuessStats stats;
+    stats.attempts = m_attempts.load(std::memory_order_relaxed);
+    stats.boards = m_boards.load(std::memory_order_relaxed);
+    stats.nanoseconds = m_nanoseconds.load(std::memory_order_relaxed);
+    stats.seconds = std::chrono::duration<real64>(std::chrono::steady_clock::now() - m_start).count();
+    return stats;
+}
+
+void NoGuessGenerator::Report(FILE* file) const
+{
+    NoGuessStats stats = Stats();
+    real64 density = 100.0 * m_mines / (real64(m_rows) * m_cols);
+    std::fprintf(file, "No-guess %ux%u/%u (%.1f%% mines): %" PRIu64 " boards from %" PRIu64 " attempts (%.2f%%) in %.3fs on %u threads: "
+                 "%.1f boards/s, %.0f attempts/s, %.1fus per attempt.\n",
+                 m_rows, m_cols, m_mines, density, stats.boards, stats.attempts,
+                 (stats.attempts ? 100.0 * stats.boards / stats.attempts : 0), stats.seconds, m_threads,
+                 (stats.seconds > 0 ? stats.boards / stats.seconds : 0), (stats.seconds > 0 ? stats.attempts / stats.seconds : 0),
+                 (stats.attempts ? stats.nanoseconds / 1000.0 / stats.attempts : 0));
+}
+
+void NoGuessGenerator::Work()
+{
+    Board board;
+    Solver solver;
+    while (m_running.load(std::memory_order_acquire))
+    {
+        // Boards come back from the pool with whatever size the game last played.
+        if (board.Rows() != m_rows || board.Cols() != m_cols || board.Mines() != m_mines)
+            board.Init(m_rows, m_cols, m_mines);
+        
+        auto start = std::chrono::steady_clock::now();
+        uint64 seed = BatchGameSeed(m_seed, m_nextAttempt.fetch_add(1, std::memory_order_relaxed));
+        bool solved = Attempt(board, solver, seed);
+        if (solved)
+        {
+            // Deal it again as the player gets it: only the opening revealed.
+            board.Generate(seed);
+            board.Reveal(m_rows / 2, m_cols / 2);
+        }
+        uint64 nanoseconds = uint64(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        m_nanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+        m_attempts.fetch_add(1, std::memory_order_relaxed);
+        
+        if (solved)
+            Publish(board);
+    }
+}
+
+bool NoGuessGenerator::Attempt(Board& board, Solver& solver, uint64 seed)
+{
+    board.Generate(seed);
+    board.Reveal(m_rows / 2, m_cols / 2);
+    solver.Reset(board);
+    uint32 cell;
+    while (board.State() == GAME_PLAYING && solver.NextSafe(board, cell))
+    {
+        board.Reveal(cell / m_cols, cell % m_cols);
+        solver.Track(board);
+    }
+    return board.State() == GAME_WON;
+}
+
+bool NoGuessGenerator::Publish(Board& board)
+{
+    uint64 pos = m_head.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        Slot& slot = m_slots[pos & (NO_GUESS_POOL_SLOTS - 1)];
+        int64 diff = int64(slot.sequence.load(std::memory_order_acquire) - pos);
+        if (diff == 0)
+        {
+            if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                std::swap(board, slot.board);
+                m_boards.fetch_add(1, std::memory_order_relaxed);
+                slot.sequence.store(pos + 1, std::memory_order_release);
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            // Full: sleep until the game takes a board or the generator stops.
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+            m_spaceWake.wait(lock, [&]()
+            {
+                return !m_running.load(std::memory_order_acquire) || int64(slot.sequence.load(std::memory_order_acquire) - pos) >= 0;
+            });
+            if (!m_running.load(std::memory_order_acquire))
+                return false;
+        }
+        else
+        {
+            pos = m_head.load(std::memory_order_relaxed);
+        }
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+    }
+    m_readyWake.notify_one();
+    return true;
+}
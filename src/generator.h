@@ -0,0 +1,102 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include "common.h"
+#include "board.h"
+#include "solver.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio> // FILE
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/*
+    No-guess boards: boards the Solver finishes from their opening without ever guessing.
+
+    Workers deal a board, open it at its middle cell (the first reveal is always safe, see Board::ClearOpening)
+    and let the solver play it out. A board the solver wins is dealt again from the same seed, opened the same
+    way and published to a bounded pool, so the game starts a new one by taking it instead of generating.
+
+    The pool is a ring of board slots claimed like the log's (bounded MPMC queue, Vyukov): a worker claims a slot
+    with one compare-and-swap and the game takes them in order without locks. Boards are swapped in and out of the
+    slots rather than copied, so the game's old board becomes a worker's next scratch board. Threads only take the
+    mutex to sleep: workers when the pool is full, the game when it is empty.
+*/
+
+#define NO_GUESS_POOL_SLOTS 8
+// Longest the game waits for a board when the pool is empty before it deals an ordinary one instead.
+#define NO_GUESS_WAIT_MS 2000
+
+struct NoGuessStats
+{
+    uint64 attempts = 0; // Boards dealt and played by the solver.
+    uint64 boards = 0; // Of those, ones it won without guessing that made it into the pool.
+    uint64 nanoseconds = 0; // Worker time spent on attempts, summed over the workers.
+    real64 seconds = 0.0; // Wall time since Start.
+};
+
+class NoGuessGenerator
+{
+public:
+    ~NoGuessGenerator() { Stop(); }
+    
+    // Starts threads workers (0 picks one per hardware thread but the caller's) filling the pool with boards of
+    // the given size. Attempt n is dealt from BatchGameSeed(seed, n); which attempts end up in the pool, and in
+    // what order, depends on the threads' timing.
+    ResultBool Start(uint32 rows, uint32 cols, uint32 mines, uint64 seed, uint32 threads);
+    // Stops the workers; Take finds nothing until the next Start, which empties the pool.
+    void Stop();
+    bool IsRunning() const { return !m_workers.empty(); }
+    
+    // Swaps the next pooled board, already opened, into board. Waits up to waitMs for one when the pool is empty
+    // and returns false if none came.
+    bool Take(Board& board, uint32 waitMs);
+    NoGuessStats Stats() const;
+    // Prints the size, density and throughput so far to file.
+    void Report(FILE* file) const;
+
+private:
+    struct alignas(64) Slot
+    {
+        std::atomic<uint64> sequence; // Free for position p when p; holds the board for p when p + 1.
+        Board board;
+    };
+    
+    void Work();
+    // Deals board from seed, opens it and plays the solver; true if it won without guessing.
+    bool Attempt(Board& board, Solver& solver, uint64 seed);
+    // Swaps board into a free slot, waiting while the pool is full; false if the generator stopped first.
+    bool Publish(Board& board);
+    
+    uint32 m_rows = 0;
+    uint32 m_cols = 0;
+    uint32 m_mines = 0;
+    uint64 m_seed = 0;
+    uint32 m_threads = 0;
+    Slot m_slots[NO_GUESS_POOL_SLOTS];
+    std::atomic<uint64> m_head{0}; // Next position to claim; shared by every worker.
+    uint64 m_tail = 0; // Next position to take; only the game touches it.
+    std::atomic<uint64> m_nextAttempt{0};
+    std::atomic<uint64> m_attempts{0};
+    std::atomic<uint64> m_boards{0};
+    std::atomic<uint64> m_nanoseconds{0};
+    std::chrono::steady_clock::time_point m_start;
+    std::atomic<bool> m_running{false};
+    std::vector<std::thread> m_workers;
+    std::mutex m_wakeMutex;
+    std::condition_variable m_readyWake; // A board was published.
+    std::condition_variable m_spaceWake; // A slot was freed, or the generator is stopping.
+};
+
+#endif
@@ -0,0 +1,428 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+/*
+    Runs the game rules without SDL, video or audio at full CPU speed.
+
+    Random play (default): every game reveals random covered cells until it is won or lost.
+    Solver play (--solver): reveals provably safe cells and only guesses when the solver is stuck.
+    Both are played in a batch across --threads <n> workers (default: one per hardware thread);
+    every game's seed depends only on --seed and its number, so the counts never depend on the thread count.
+    Scripted play (--script <file>): one move per line, '#' starts a comment:
+        reveal <row> <col>
+        chord <row> <col>
+        mark <row> <col>
+        new
+    "new" starts the next game; every game's seed is drawn from the --seed generator.
+    Recorded play (--record <file>): random or solver play on one thread through the game's own input handling,
+    saved as an input recording (see replay.h) that the game and --replay can play back.
+    Replay (--replay <file>): plays a recording made here or by the game with --record, as fast as possible,
+    or at the recorded speed with --realtime. The board size and seed come from the recording.
+    No-guess generation (--no-guess): takes --games boards from a NoGuessGenerator running --threads workers and
+    reports its throughput for the board size and density.
+*/
+
+#include "common.h"
+#include "args.h"
+#include "board.h"
+#include "batch.h"
+#include "generator.h"
+#include "log.h"
+#include "random.h"
+#include "replay.h"
+
+#include <chrono>
+#include <ctime> // time
+#include <cstdio> // fwrite, printf
+#include <fstream>
+#include <sstream>
+#include <thread> // sleep_until
+
+
+static void CountGame(const Board& board, BatchStats& stats)
+{
+    stats.games++;
+    if (board.State() == GAME_WON)
+        stats.wins++;
+    else if (board.State() == GAME_LOST)
+        stats.losses++;
+}
+
+// Draws like the window does: '#' covered, 'F' flagged, '?' guessed, '*' exploded, digits for revealed cells.
+static void PrintBoard(const Board& board)
+{
+    for (uint32 r = 0; r < board.Rows(); r++)
+    {
+        std::string line;
+        for (uint32 c = 0; c < board.Cols(); c++)
+        {
+            if (board.IsExploded(r, c))
+                line += '*';
+            else if (board.IsRevealed(r, c))
+                line += char('0' + board.MinesNearby(r, c));
+            else if (board.IsFlagged(r, c))
+                line += 'F';
+            else if (board.IsGuessed(r, c))
+                line += '?';
+            else
+                line += '#';
+        }
+        line += '\n';
+        std::fwrite(line.data(), 1, line.size(), stdout);
+    }
+}
+
+static bool PlayScript(Board& board, Random& rng, const std::string& file, bool print, BatchStats& stats)
+{
+    std::ifstream in(file);
+    if (!in)
+    {
+        LOG_FAIL("Failed to open script: %s", file.c_str());
+        return false;
+    }
+    
+    board.Generate(rng.Next());
+    std::string line;
+    uint64 lineNumber = 0;
+    while (std::getline(in, line))
+    {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        std::string action;
+        if (!(words >> action))
+            continue;
+        
+        if (action == "new")
+        {
+            CountGame(board, stats);
+            if (print)
+                PrintBoard(board);
+            board.Generate(rng.Next());
+            continue;
+        }
+        
+        int64 r = -1;
+        int64 c = -1;
+        if (!(words >> r >> c) || !board.InBounds(r, c))
+        {
+            LOG_FAIL("%s:%" PRIu64 ": Expected <row> <col> inside the board.", file.c_str(), lineNumber);
+            return false;
+        }
+        
+        if (action == "reveal")
+        {
+            board.Reveal(uint32(r), uint32(c));
+        }
+        else if (action == "chord")
+        {
+            board.Chord(uint32(r), uint32(c));
+        }
+        else if (action == "mark")
+        {
+            board.CycleMark(uint32(r), uint32(c));
+        }
+        else
+        {
+            LOG_FAIL("%s:%" PRIu64 ": Unknown action: %s", file.c_str(), lineNumber, action.c_str());
+            return false;
+        }
+        stats.moves++;
+    }
+    
+    CountGame(board, stats);
+    if (print)
+        PrintBoard(board);
+    return true;
+}
+
+// Plays games like RunBatch does, but one after another on this thread and through ApplyInput, recording every input.
+static bool RecordGames(Board& board, BatchPlayer player, uint64 seed, uint64 games, const std::string& file, BatchStats& stats)
+{
+    InputRecorder recorder;
+    ResultBool recorderOpen = recorder.Open(file, board.Rows(), board.Cols(), board.Mines(), seed);
+    if (!recorderOpen)
+    {
+        LOG_FAIL("%s", recorderOpen.error.c_str());
+        return false;
+    }
+    
+    Solver solver;
+    Random rng(seed);
+    Random picks(~seed);
+    auto start = std::chrono::steady_clock::now();
+    NewGame(board, solver, rng);
+    for (uint64 g = 0; g < games; g++)
+    {
+        InputEvent input = {0, INPUT_NEW_GAME, BOARD_NO_CELL};
+        if (g > 0)
+        {
+            input.time = uint64(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+            recorder.Record(input);
+            ApplyInput(board, solver, rng, input);
+        }
+        
+        while (board.State() == GAME_PLAYING)
+        {
+            // Solver play presses H, as a player would, and only guesses when the hint finds nothing. The solver is
+            // never asked anything outside ApplyInput: when it propagates decides which safe cell a hint picks.
+            input.time = uint64(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+            if (player == BATCH_SOLVER)
+            {
+                input.action = INPUT_HINT;
+                input.cell = BOARD_NO_CELL;
+                recorder.Record(input);
+                InputResult hint = ApplyInput(board, solver, rng, input);
+                stats.moves++;
+                if (hint.changed || hint.flagged != BOARD_NO_CELL)
+                    continue;
+                stats.guesses++;
+            }
+            
+            uint32 cell;
+            do
+            {
+                cell = picks.Below(board.CellCount());
+            }
+            while (board.IsRevealed(cell / board.Cols(), cell % board.Cols()) || board.IsFlagged(cell / board.Cols(), cell % board.Cols()));
+            input.action = INPUT_REVEAL;
+            input.cell = cell;
+            recorder.Record(input);
+            ApplyInput(board, solver, rng, input);
+            stats.moves++;
+        }
+        CountGame(board, stats);
+    }
+    
+    ResultBool recorderClose = recorder.Close();
+    if (!recorderClose)
+    {
+        LOG_FAIL("%s", recorderClose.error.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Takes boards from the pool as fast as the workers fill it, as the game would if every game took no time.
+static bool GenerateNoGuess(Board& board, const GameMode& mode, uint64 seed, uint64 games, uint32 threads, BatchStats& stats)
+{
+    NoGuessGenerator generator;
+    ResultBool generatorStart = generator.Start(mode.rows, mode.cols, mode.mines, seed, threads);
+    if (!generatorStart)
+    {
+        LOG_FAIL("%s", generatorStart.error.c_str());
+        return false;
+    }
+    
+    for (uint64 g = 0; g < games; g++)
+    {
+        // A size and density no attempt gets through would wait forever; give up after one long wait.
+        if (!generator.Take(board, NO_GUESS_WAIT_MS * 5))
+        {
+            LOG_FAIL("No no-guess board was found in %d seconds.", NO_GUESS_WAIT_MS * 5 / 1000);
+            generator.Report(stdout);
+            return false;
+        }
+        stats.games++;
+    }
+    generator.Report(stdout);
+    return true;
+}
+
+// Plays every input of a recording; the board must already have the recording's size.
+static bool ReplayGames(Board& board, InputReplay& replay, bool realtime, BatchStats& stats)
+{
+    Solver solver;
+    Random rng(replay.Header().seed);
+    auto start = std::chrono::steady_clock::now();
+    NewGame(board, solver, rng);
+    
+    InputEvent input;
+    while (replay.Next(input))
+    {
+        if (realtime)
+            std::this_thread::sleep_until(start + std::chrono::milliseconds(input.time));
+        if (input.action == INPUT_NEW_GAME)
+            CountGame(board, stats);
+        else
+            stats.moves++;
+        ApplyInput(board, solver, rng, input);
+    }
+    CountGame(board, stats);
+    
+    if (replay.Failed())
+    {
+        LOG_FAIL("The input recording is corrupt after %" PRIu64 " inputs.", stats.moves);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    GameMode mode = GAME_MODE_EXPERT;
+    uint64 seed = 0;
+    bool seedSet = false;
+    uint64 games = 1;
+    std::string script;
+    bool print = false;
+    bool useSolver = false;
+    uint32 threads = 0;
+    std::string recordFile;
+    std::string replayFile;
+    bool realtime = false;
+    bool noGuess = false;
+    
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        ArgResult result = ParseGameArg(argc, argv, i, mode, seed, seedSet);
+        if (result == ARG_INVALID)
+            return 1;
+        if (result == ARG_OK)
+            continue;
+        
+        if (arg == "--games" && i + 1 < argc && ParseUint64(argv[i+1], games))
+        {
+            i++;
+        }
+        else if (arg == "--threads" && i + 1 < argc && ParseUint32(argv[i+1], threads))
+        {
+            i++;
+        }
+        else if (arg == "--script" && i + 1 < argc)
+        {
+            script = argv[++i];
+        }
+        else if (arg == "--print")
+        {
+            print = true;
+        }
+        else if (arg == "--solver")
+        {
+            useSolver = true;
+        }
+        else if (arg == "--record" && i + 1 < argc)
+        {
+            recordFile = argv[++i];
+        }
+        else if (arg == "--replay" && i + 1 < argc)
+        {
+            replayFile = argv[++i];
+        }
+        else if (arg == "--realtime")
+        {
+            realtime = true;
+        }
+        else if (arg == "--no-guess")
+        {
+            noGuess = true;
+        }
+        else
+        {
+            LOG_FAIL("Unknown argument: %s", arg.c_str());
+            // Printed, not logged: log lines are cut at LOG_LINE_SIZE.
+            std::printf("Usage: minesweeper_headless " GAME_ARGS_USAGE " [--games <n>] [--threads <n>] [--solver | --script <file>] [--record <file>]"
+                        " [--replay <file> [--realtime]] [--no-guess] [--print]\n");
+            return 1;
+        }
+    }
+    
+    if (!seedSet)
+        seed = uint64(std::time(nullptr));
+    
+    InputReplay replay;
+    if (!replayFile.empty())
+    {
+        ResultBool replayOpen = replay.Open(replayFile);
+        if (!replayOpen)
+        {
+            LOG_FAIL("%s", replayOpen.error.c_str());
+            return 1;
+        }
+        mode = {"recorded", replay.Header().rows, replay.Header().cols, replay.Header().mines};
+        seed = replay.Header().seed;
+    }
+    
+    Board board;
+    ResultBool boardInit = board.Init(mode.rows, mode.cols, mode.mines);
+    if (!boardInit)
+    {
+        LOG_FAIL("%s", boardInit.error.c_str());
+        return 1;
+    }
+    
+    BatchPlayer player = (useSolver ? BATCH_SOLVER : BATCH_RANDOM);
+    BatchStats stats;
+    bool batch = (script.empty() && recordFile.empty() && replayFile.empty() && !noGuess);
+    auto start = std::chrono::steady_clock::now();
+    if (!replayFile.empty())
+    {
+        if (!ReplayGames(board, replay, realtime, stats))
+            return 1;
+    }
+    else if (!recordFile.empty())
+    {
+        if (!RecordGames(board, player, seed, games, recordFile, stats))
+            return 1;
+    }
+    else if (noGuess)
+    {
+        if (!GenerateNoGuess(board, mode, seed, games, threads, stats))
+            return 1;
+    }
+    else if (!script.empty())
+    {
+        Random rng(seed);
+        if (!PlayScript(board, rng, script, print, stats))
+            return 1;
+    }
+    else
+    {
+        ResultBool batchRun = RunBatch(mode, player, seed, games, threads, stats);
+        if (!batchRun)
+        {
+            LOG_FAIL("%s", batchRun.error.c_str());
+            return 1;
+        }
+    }
+    real64 seconds = std::chrono::duration<real64>(std::chrono::steady_clock::now() - start).count();
+    if (noGuess)
+    {
+        // The generator reported its own throughput; the last board taken is still unplayed.
+        if (print)
+            PrintBoard(board);
+        return 0;
+    }
+    
+    if (!batch && script.empty() && print)
+    {
+        // Recorded and replayed games end on this board.
+        PrintBoard(board);
+    }
+    if (batch && print && games > 0)
+    {
+        // Workers do not keep their boards, so replay the last game on this one.
+        Solver solver;
+        BatchStats replay;
+        PlayGame(board, solver, player, BatchGameSeed(seed, games - 1), replay);
+        PrintBoard(board);
+    }
+    
+    // Results are printed, not logged, so builds with a higher MINESWEEPER_LOG_LEVEL still show them.
+    std::printf("%s %ux%u/%u seed %" PRIu64 ": %" PRIu64 " games, %" PRIu64 " won, %" PRIu64 " lost (%.2f%% win rate), "
+                "%" PRIu64 " moves (%" PRIu64 " guesses) in %.3fs (%.0f games/s, %.0f moves/s).\n",
+                mode.name, mode.rows, mode.cols, mode.mines, seed, stats.games, stats.wins, stats.losses,
+                (stats.games ? 100.0 * stats.wins / stats.games : 0), stats.moves, stats.guesses, seconds,
+                (seconds > 0 ? stats.games / seconds : 0), (seconds > 0 ? stats.moves / seconds : 0));
+    if (batch && stats.games > 0)
+    {
+        std::printf("Per game: %.2fus mean, %.2fus min, %.2fus max.\n", stats.nanoseconds / 1000.0 / stats.games,
+                    stats.minNanoseconds / 1000.0, stats.maxNanoseconds / 1000.0);
+    }
+    return 0;
+}
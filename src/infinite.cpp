@@ -0,0 +1,617 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+#include "infinite.h"
+#include "log.h"
+#include "random.h"
+
+#include <algorithm> // fill, nth_element
+#include <cstdio> // remove
+#include <sstream>
+
+
+// Planes a stored chunk keeps; its mines are generated again and the rest is derived.
+static const BoardPlane STORED_PLANES[] = {PLANE_REVEALED, PLANE_FLAGGED, PLANE_GUESSED};
+// Chunk coordinates are in [-CHUNK_LIMIT, CHUNK_LIMIT).
+static const int32 CHUNK_LIMIT = int32(INFINITE_MAX_COORD >> INFINITE_CHUNK_BITS);
+
+// Chunk holding cell coordinate v, rounding toward negative infinity.
+static int32 ChunkCoord(int64 v)
+{
+    return int32((v >= 0 ? v : v - (INFINITE_CHUNK_SIZE - 1)) / INFINITE_CHUNK_SIZE);
+}
+
+// Row or column of cell coordinate v inside its chunk.
+static uint32 ChunkOffset(int64 v)
+{
+    return uint32(v - int64(ChunkCoord(v)) * INFINITE_CHUNK_SIZE);
+}
+
+static uint64 ChunkKey(int32 cy, int32 cx)
+{
+    return (uint64(uint32(cy)) << 32) | uint32(cx);
+}
+
+InfiniteBoard::~InfiniteBoard()
+{
+    if (m_spill.is_open())
+    {
+        m_spill.close();
+        std::remove(m_spillPath.c_str());
+    }
+}
+
+ResultBool InfiniteBoard::Init(uint64 seed, real64 density, uint32 residentChunks, MemorySize storeBytes, const std::string& spillPath)
+{
+    ResultBool ret = {false, ""};
+    
+    if (!(density >= INFINITE_MIN_DENSITY && density <= INFINITE_MAX_DENSITY))
+    {
+        std::stringstream ss;
+        ss << "Mine density " << density * 100 << "% is outside of " << INFINITE_MIN_DENSITY * 100 << "% to "
+           << INFINITE_MAX_DENSITY * 100 << "% for an infinite board.";
+        ret.error = ss.str();
+        return ret;
+    }
+    if (residentChunks == 0)
+    {
+        ret.error = "An infinite board needs room for at least one chunk.";
+        return ret;
+    }
+    
+    m_chunkMines = uint32(density * INFINITE_CHUNK_CELLS + 0.5);
+    m_residentLimit = residentChunks;
+    m_storeLimit = storeBytes;
+    m_spillPath = spillPath;
+    Reset(seed);
+    if (!m_spillPath.empty() && !m_spill.is_open())
+    {
+        ret.error = "Failed to create " + m_spillPath + ".";
+        return ret;
+    }
+    
+    ret.result = true;
+    return ret;
+}
+
+void InfiniteBoard::Reset(uint64 seed)
+{
+    m_seed = seed;
+    m_state = GAME_PLAYING;
+    m_exploded = {0, 0};
+    m_revealed = 0;
+    m_tick = 0;
+    m_changed.clear();
+    m_flood.clear();
+    
+    // Chunk allocations are kept for the next game.
+    m_index.clear();
+    m_freeSlots.clear();
+    for (uint32 slot = uint32(m_chunks.size()); slot > 0; slot--)
+        m_freeSlots.push_back(slot - 1);
+    m_lastSlot = UINT32_MAX;
+    
+    m_stored.clear();
+    m_storedBytes = 0;
+    m_spillSize = 0;
+    if (!m_spillPath.empty())
+    {
+        m_spill.close();
+        m_spill.clear();
+        m_spill.open(m_spillPath, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    }
+}
+
+// Floyd's sampling as in Board::Generate, from a seed that mixes the board's seed with the chunk's coordinate.
+void InfiniteBoard::GenerateMines(int32 cy, int32 cx, uint64 mines[INFINITE_CHUNK_SIZE]) const
+{
+    std::fill(mines, mines + INFINITE_CHUNK_SIZE, 0);
+    uint64 key = ChunkKey(cy, cx);
+    Random rng(m_seed ^ SplitMix64(key));
+    for (uint32 j = INFINITE_CHUNK_CELLS - m_chunkMines; j < INFINITE_CHUNK_CELLS; j++)
+    {
+        uint32 t = rng.Below(j + 1);
+        if ((mines[t / INFINITE_CHUNK_SIZE] >> (t % INFINITE_CHUNK_SIZE)) & 1)
+            t = j;
+        mines[t / INFINITE_CHUNK_SIZE] |= uint64(1) << (t % INFINITE_CHUNK_SIZE);
+    }
+}
+
+InfiniteChunk* InfiniteBoard::Allocate(int32 cy, int32 cx)
+{
+    uint32 slot;
+    if (!m_freeSlots.empty())
+    {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    }
+    else
+    {
+        slot = uint32(m_chunks.size());
+        m_chunks.push_back(std::make_unique<InfiniteChunk>());
+    }
+    
+    InfiniteChunk& chunk = *m_chunks[slot];
+    ZERO_STRUCT(chunk);
+    GenerateMines(cy, cx, chunk.bits[PLANE_MINE]);
+    chunk.cy = cy;
+    chunk.cx = cx;
+    chunk.lastUse = m_tick;
+    
+    uint64 key = ChunkKey(cy, cx);
+    m_index[key] = slot;
+    m_lastKey = key;
+    m_lastSlot = slot;
+    return &chunk;
+}
+
+InfiniteChunk* InfiniteBoard::Find(int32 cy, int32 cx)
+{
+    uint64 key = ChunkKey(cy, cx);
+    if (m_lastSlot == UINT32_MAX || key != m_lastKey)
+    {
+        auto it = m_index.find(key);
+        if (it == m_index.end())
+        {
+            auto stored = m_stored.find(key);
+            if (stored == m_stored.end())
+                return nullptr;
+            
+            InfiniteChunk* chunk = Allocate(cy, cx);
+            if (!Load(*chunk, stored->second))
+            {
+                LOG_FAIL("Failed to read back chunk %d, %d; it starts over.", cy, cx);
+                for (BoardPlane p : STORED_PLANES)
+                    std::fill(chunk->bits[p], chunk->bits[p] + INFINITE_CHUNK_SIZE, 0);
+                if (!stored->second.data.empty())
+                    m_storedBytes -= stored->second.size;
+                m_stored.erase(stored);
+            }
+            return chunk;
+        }
+        m_lastKey = key;
+        m_lastSlot = it->second;
+    }
+    
+    InfiniteChunk* chunk = m_chunks[m_lastSlot].get();
+    chunk->lastUse = m_tick;
+    return chunk;
+}
+
+InfiniteChunk* InfiniteBoard::Chunk(int32 cy, int32 cx)
+{
+    InfiniteChunk* chunk = Find(cy, cx);
+    if (!chunk)
+        chunk = Allocate(cy, cx);
+    if (!chunk->counted)
+        Count(*chunk);
+    return chunk;
+}
+
+/*
+    Same bit-sliced counts as Board::CountNeighborsRowBitboard, over the chunk's row words with the rows and
+    columns just outside it taken from the neighboring chunks' mines. Those are read from resident chunks or
+    generated, since mines never change; neighbors are not made resident for it.
+*/
+void InfiniteBoard::Count(InfiniteChunk& chunk)
+{
+    // Rows -1 to INFINITE_CHUNK_SIZE of the chunk's column of chunks and the columns on either side.
+    uint64 mines[3][INFINITE_CHUNK_SIZE + 2];
+    uint64 generated[INFINITE_CHUNK_SIZE];
+    for (int32 dy = -1; dy <= 1; dy++)
+    {
+        for (int32 dx = -1; dx <= 1; dx++)
+        {
+            const uint64* src = chunk.bits[PLANE_MINE];
+            if (dy || dx)
+            {
+                auto it = m_index.find(ChunkKey(chunk.cy + dy, chunk.cx + dx));
+                if (it != m_index.end())
+                {
+                    src = m_chunks[it->second]->bits[PLANE_MINE];
+                }
+                else
+                {
+                    GenerateMines(chunk.cy + dy, chunk.cx + dx, generated);
+                    src = generated;
+                }
+            }
+            
+            uint64* dst = mines[dx + 1];
+            if (dy < 0)
+                dst[0] = src[INFINITE_CHUNK_SIZE - 1];
+            else if (dy > 0)
+                dst[INFINITE_CHUNK_SIZE + 1] = src[0];
+            else
+                std::copy(src, src + INFINITE_CHUNK_SIZE, dst + 1);
+        }
+    }
+    
+    for (uint32 r = 0; r < INFINITE_CHUNK_SIZE; r++)
+    {
+        uint64 col0[3];
+        uint64 col1[3];
+        for (uint32 x = 0; x < 3; x++)
+        {
+            uint64 up = mines[x][r];
+            uint64 self = mines[x][r + 1];
+            uint64 down = mines[x][r + 2];
+            col0[x] = up ^ self ^ down;
+            col1[x] = (up & self) | (down & (up ^ self));
+        }
+        
+        uint64 l0 = (col0[1] << 1) | (col0[0] >> 63);
+        uint64 l1 = (col1[1] << 1) | (col1[0] >> 63);
+        uint64 r0 = (col0[1] >> 1) | (col0[2] << 63);
+        uint64 r1 = (col1[1] >> 1) | (col1[2] << 63);
+        uint64 up = mines[1][r];
+        uint64 down = mines[1][r + 2];
+        uint64 t[4];
+        AddNeighborSums(l0, l1, r0, r1, up ^ down, up & down, t);
+        
+        for (uint32 k = 0; k < 4; k++)
+            chunk.nearby[k][r] = t[k];
+        chunk.bits[PLANE_EMPTY][r] = ~(t[0] | t[1] | t[2] | t[3] | mines[1][r + 1]);
+    }
+    chunk.counted = true;
+}
+
+bool InfiniteBoard::Get(BoardPlane p, int64 r, int64 c)
+{
+    assert(InBounds(r, c));
+    InfiniteChunk* chunk = Find(ChunkCoord(r), ChunkCoord(c));
+    if (chunk)
+        return (chunk->bits[p][ChunkOffset(r)] >> ChunkOffset(c)) & 1;
+    
+    // Nothing is revealed or marked in an untouched chunk.
+    if (p != PLANE_MINE)
+        return false;
+    uint64 mines[INFINITE_CHUNK_SIZE];
+    GenerateMines(ChunkCoord(r), ChunkCoord(c), mines);
+    return (mines[ChunkOffset(r)] >> ChunkOffset(c)) & 1;
+}
+
+uint8 InfiniteBoard::MinesNearby(int64 r, int64 c)
+{
+    assert(InBounds(r, c));
+    const InfiniteChunk* chunk = Chunk(ChunkCoord(r), ChunkCoord(c));
+    uint32 row = ChunkOffset(r);
+    uint32 col = ChunkOffset(c);
+    uint8 count = 0;
+    for (uint32 k = 0; k < 4; k++)
+        count |= uint8(((chunk->nearby[k][row] >> col) & 1) << k);
+    return count;
+}
+
+void InfiniteBoard::Trim()
+{
+    m_tick++;
+    if (m_index.size() <= m_residentLimit)
+        return;
+    
+    // Evict down to three quarters of the limit so the sort is not repeated every frame.
+    std::vector<uint32> slots;
+    slots.reserve(m_index.size());
+    for (const auto& entry : m_index)
+        slots.push_back(entry.second);
+    MemorySize evict = slots.size() - m_residentLimit * MemorySize(3) / 4;
+    std::nth_element(slots.begin(), slots.begin() + evict, slots.end(),
+                     [this](uint32 a, uint32 b) { return m_chunks[a]->lastUse < m_chunks[b]->lastUse; });
+    for (MemoryIndex i = 0; i < evict; i++)
+    {
+        // Chunks used during the last frame may still be on screen.
+        if (m_chunks[slots[i]]->lastUse + 1 < m_tick)
+            Evict(slots[i]);
+    }
+}
+
+void InfiniteBoard::Evict(uint32 slot)
+{
+    const InfiniteChunk& chunk = *m_chunks[slot];
+    if (chunk.modified)
+        Store(chunk);
+    m_index.erase(ChunkKey(chunk.cy, chunk.cx));
+    m_freeSlots.push_back(slot);
+    if (m_lastSlot == slot)
+        m_lastSlot = UINT32_MAX;
+}
+
+/*
+    Each stored plane is a mask of its non-zero rows, a mask of its all-ones rows and then the words of the rows
+    that are neither. A chunk with a few revealed openings takes a few hundred bytes instead of 4.6 KB.
+*/
+void InfiniteBoard::Store(const InfiniteChunk& chunk)
+{
+    std::vector<uint8> data;
+    for (BoardPlane p : STORED_PLANES)
+    {
+        uint64 masks[2] = {0, 0};
+        for (uint32 r = 0; r < INFINITE_CHUNK_SIZE; r++)
+        {
+            if (chunk.bits[p][r] == ~uint64(0))
+                masks[1] |= uint64(1) << r;
+            else if (chunk.bits[p][r])
+                masks[0] |= uint64(1) << r;
+        }
+        const uint8* m = reinterpret_cast<const uint8*>(masks);
+        data.insert(data.end(), m, m + sizeof(masks));
+        for (uint64 rows = masks[0]; rows; rows &= rows - 1)
+        {
+            const uint8* w = reinterpret_cast<const uint8*>(&chunk.bits[p][CountTrailingZeros64(rows)]);
+            data.insert(data.end(), w, w + sizeof(uint64));
+        }
+    }
+    
+    StoredChunk& stored = m_stored[ChunkKey(chunk.cy, chunk.cx)];
+    if (!stored.data.empty())
+    {
+        m_storedBytes -= stored.size;
+        stored.data.clear();
+    }
+    if (m_storedBytes + data.size() > m_storeLimit)
+        Spill();
+    stored.size = uint32(data.size());
+    stored.offset = 0;
+    stored.data = std::move(data);
+    m_storedBytes += stored.size;
+}
+
+bool InfiniteBoard::Load(InfiniteChunk& chunk, const StoredChunk& stored)
+{
+    const uint8* data = stored.data.data();
+    std::vector<uint8> buffer;
+    if (stored.data.empty())
+    {
+        if (!m_spill.is_open())
+            return false;
+        buffer.resize(stored.size);
+        m_spill.seekg(std::streamoff(stored.offset));
+        m_spill.read(reinterpret_cast<char*>(buffer.data()), std::streamsize(buffer.size()));
+        if (!m_spill)
+        {
+            m_spill.clear();
+            return false;
+        }
+        data = buffer.data();
+    }
+    
+    MemoryIndex pos = 0;
+    for (BoardPlane p : STORED_PLANES)
+    {
+        uint64 masks[2];
+        if (pos + sizeof(masks) > stored.size)
+            return false;
+        std::memcpy(masks, data + pos, sizeof(masks));
+        pos += sizeof(masks);
+        for (uint32 r = 0; r < INFINITE_CHUNK_SIZE; r++)
+        {
+            uint64 bit = uint64(1) << r;
+            if (masks[1] & bit)
+            {
+                chunk.bits[p][r] = ~uint64(0);
+            }
+            else if (masks[0] & bit)
+            {
+                if (pos + sizeof(uint64) > stored.size)
+                    return false;
+                std::memcpy(&chunk.bits[p][r], data + pos, sizeof(uint64));
+                pos += sizeof(uint64);
+            }
+        }
+    }
+    
+    // Matches its stored copy until the next move changes it.
+    chunk.modified = false;
+    return true;
+}
+
+// Moves every stored chunk still in memory to the end of the spill file. Space of chunks read back is not reused.
+void InfiniteBoard::Spill()
+{
+    if (!m_spill.is_open())
+        return;
+    
+    m_spill.seekp(std::streamoff(m_spillSize));
+    for (auto& entry : m_stored)
+    {
+        StoredChunk& stored = entry.second;
+        if (stored.data.empty())
+            continue;
+        
+        m_spill.write(reinterpret_cast<const char*>(stored.data.data()), std::streamsize(stored.size));
+        if (!m_spill)
+        {
+            LOG_FAIL("Failed to write %s; keeping the infinite board's chunks in memory.", m_spillPath.c_str());
+            m_spill.close();
+            return;
+        }
+        stored.offset = m_spillSize;
+        m_spillSize += stored.size;
+        m_storedBytes -= stored.size;
+        std::vector<uint8>().swap(stored.data);
+    }
+    m_spill.flush();
+}
+
+MoveResult InfiniteBoard::RevealCell(int64 r, int64 c)
+{
+    InfiniteChunk* chunk = Chunk(ChunkCoord(r), ChunkCoord(c));
+    uint32 row = ChunkOffset(r);
+    uint64 bit = uint64(1) << ChunkOffset(c);
+    if ((chunk->bits[PLANE_REVEALED][row] | chunk->bits[PLANE_FLAGGED][row]) & bit)
+        return MOVE_NONE;
+    
+    if (chunk->bits[PLANE_MINE][row] & bit)
+    {
+        m_exploded = {r, c};
+        m_changed.push_back({r, c});
+        m_state = GAME_LOST;
+        return MOVE_EXPLODED;
+    }
+    
+    chunk->bits[PLANE_REVEALED][row] |= bit;
+    chunk->bits[PLANE_GUESSED][row] &= ~bit;
+    chunk->modified = true;
+    m_changed.push_back({r, c});
+    m_revealed++;
+    return MOVE_REVEALED;
+}
+
+void InfiniteBoard::RevealSafeWord(int32 cy, int32 cx, int32 row, uint64 mask, bool queue)
+{
+    if (row < 0)
+    {
+        cy--;
+        row += INFINITE_CHUNK_SIZE;
+    }
+    else if (row >= INFINITE_CHUNK_SIZE)
+    {
+        cy++;
+        row -= INFINITE_CHUNK_SIZE;
+    }
+    // The plane does end, just far beyond where any flood reaches.
+    if (cy < -CHUNK_LIMIT || cy >= CHUNK_LIMIT || cx < -CHUNK_LIMIT || cx >= CHUNK_LIMIT)
+        return;
+    
+    InfiniteChunk* chunk = Chunk(cy, cx);
+    uint64 bits = mask & ~chunk->bits[PLANE_REVEALED][row] & ~chunk->bits[PLANE_FLAGGED][row];
+    if (!bits)
+        return;
+    
+    chunk->bits[PLANE_REVEALED][row] |= bits;
+    chunk->bits[PLANE_GUESSED][row] &= ~bits;
+    chunk->modified = true;
+    m_revealed += PopCount64(bits);
+    
+    int64 r = int64(cy) * INFINITE_CHUNK_SIZE + row;
+    int64 c = int64(cx) * INFINITE_CHUNK_SIZE;
+    for (uint64 b = bits; b; b &= b - 1)
+        m_changed.push_back({r, c + CountTrailingZeros64(b)});
+    
+    uint64 empty = bits & chunk->bits[PLANE_EMPTY][row];
+    if (queue && empty)
+        m_flood.push_back({cy, cx, uint32(row), empty});
+}
+
+// Board::Flood with chunk row words in place of board row words; runs that reach a chunk's edge spill into the next.
+void InfiniteBoard::Flood(MemoryIndex first)
+{
+    m_flood.clear();
+    for (MemoryIndex i = first; i < m_changed.size(); i++)
+    {
+        InfiniteCell cell = m_changed[i];
+        int32 cy = ChunkCoord(cell.row);
+        int32 cx = ChunkCoord(cell.col);
+        uint32 row = ChunkOffset(cell.row);
+        uint64 bit = uint64(1) << ChunkOffset(cell.col);
+        if (Chunk(cy, cx)->bits[PLANE_EMPTY][row] & bit)
+            m_flood.push_back({cy, cx, row, bit});
+    }
+    
+    while (!m_flood.empty())
+    {
+        FloodItem item = m_flood.back();
+        m_flood.pop_back();
+        
+        const InfiniteChunk* chunk = Chunk(item.cy, item.cx);
+        uint64 runs = chunk->bits[PLANE_EMPTY][item.row] & ~chunk->bits[PLANE_FLAGGED][item.row];
+        uint64 run = FillRuns(item.bits, runs);
+        uint64 wide = run | (run << 1) | (run >> 1);
+        int32 row = int32(item.row);
+        
+        RevealSafeWord(item.cy, item.cx, row, wide, false);
+        RevealSafeWord(item.cy, item.cx, row - 1, wide, true);
+        RevealSafeWord(item.cy, item.cx, row + 1, wide, true);
+        for (int32 r = row - 1; r <= row + 1; r++)
+        {
+            if (run & 1)
+                RevealSafeWord(item.cy, item.cx - 1, r, uint64(1) << 63, true);
+            if (run >> 63)
+                RevealSafeWord(item.cy, item.cx + 1, r, 1, true);
+        }
+    }
+}
+
+MoveResult InfiniteBoard::Reveal(int64 r, int64 c)
+{
+    m_changed.clear();
+    if (m_state != GAME_PLAYING || !InBounds(r, c))
+        return MOVE_NONE;
+    
+    MoveResult result = RevealCell(r, c);
+    if (result == MOVE_REVEALED)
+        Flood(0);
+    return result;
+}
+
+MoveResult InfiniteBoard::Chord(int64 r, int64 c)
+{
+    m_changed.clear();
+    if (m_state != GAME_PLAYING || !InBounds(r, c) || !IsRevealed(r, c))
+        return MOVE_NONE;
+    
+    uint32 flags = 0;
+    for (int32 dr = -1; dr <= 1; dr++)
+    {
+        for (int32 dc = -1; dc <= 1; dc++)
+        {
+            if ((dr || dc) && InBounds(r + dr, c + dc) && IsFlagged(r + dr, c + dc))
+                flags++;
+        }
+    }
+    if (flags != MinesNearby(r, c))
+        return MOVE_NONE;
+    
+    MoveResult result = MOVE_NONE;
+    for (int32 dr = -1; dr <= 1; dr++)
+    {
+        for (int32 dc = -1; dc <= 1; dc++)
+        {
+            if (!(dr || dc) || !InBounds(r + dr, c + dc))
+                continue;
+            
+            MoveResult m = RevealCell(r + dr, c + dc);
+            if (m == MOVE_EXPLODED)
+                return m;
+            if (m == MOVE_REVEALED)
+                result = m;
+        }
+    }
+    if (result == MOVE_REVEALED)
+        Flood(0);
+    return result;
+}
+
+void InfiniteBoard::CycleMark(int64 r, int64 c)
+{
+    m_changed.clear();
+    if (m_state != GAME_PLAYING || !InBounds(r, c))
+        return;
+    
+    InfiniteChunk* chunk = Chunk(ChunkCoord(r), ChunkCoord(c));
+    uint32 row = ChunkOffset(r);
+    uint64 bit = uint64(1) << ChunkOffset(c);
+    uint64& flagged = chunk->bits[PLANE_FLAGGED][row];
+    uint64& guessed = chunk->bits[PLANE_GUESSED][row];
+    if (chunk->bits[PLANE_REVEALED][row] & bit)
+        return;
+    
+    m_changed.push_back({r, c});
+    chunk->modified = true;
+    if (flagged & bit)
+    {
+        flagged &= ~bit; guessed |= bit;
+    }
+    else if (guessed & bit)
+    {
+        guessed &= ~bit;
+    }
+    else
+    {
+        flagged |= bit;
+    }
+}
@@ -0,0 +1,160 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+#ifndef INFINITE_H
+#define INFINITE_H
+
+#include "common.h"
+#include "board.h"
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/*
+    Infinite board: an unbounded plane split into INFINITE_CHUNK_SIZE square chunks, each holding one word per row
+    of every BoardPlane. A chunk's mines come from a hash of the seed and its coordinate, so a chunk only exists once
+    a move touches it, and can be dropped and rebuilt at any time. Neighbor counts, which need the mines of the eight
+    chunks around, are only worked out when a chunk is first revealed into.
+
+    At most a fixed number of chunks stay resident. Trim evicts the least recently used ones: untouched chunks are
+    simply dropped, and chunks with revealed or marked cells are compressed into a store, which spills to disk once
+    it outgrows its memory budget. There is no winning; the game goes on until a mine is revealed.
+*/
+
+#define INFINITE_CHUNK_BITS 6
+#define INFINITE_CHUNK_SIZE (1 << INFINITE_CHUNK_BITS) // One plane row of a chunk is one word.
+#define INFINITE_CHUNK_CELLS (INFINITE_CHUNK_SIZE * INFINITE_CHUNK_SIZE)
+// Cells are in [-INFINITE_MAX_COORD, INFINITE_MAX_COORD) on both axes, which keeps chunk coordinates in an int32.
+#define INFINITE_MAX_COORD (int64(1) << 36)
+// Below about this density empty cells can percolate, and one opening could flood without end.
+#define INFINITE_MIN_DENSITY 0.1
+#define INFINITE_MAX_DENSITY 0.9
+#define INFINITE_DEFAULT_RESIDENT 1024 // Chunks; about 4.6 MB.
+#define INFINITE_DEFAULT_STORE MEBIBYTES(16) // Compressed chunks held in memory before spilling to disk.
+
+struct InfiniteCell
+{
+    int64 row;
+    int64 col;
+};
+
+struct InfiniteChunk
+{
+    uint64 bits[PLANE_COUNT][INFINITE_CHUNK_SIZE]; // Row words of each BoardPlane; PLANE_EMPTY is valid once counted.
+    uint64 nearby[4][INFINITE_CHUNK_SIZE]; // Bit k of each cell's neighboring mine count, once counted.
+    int32 cy;
+    int32 cx;
+    uint64 lastUse; // Trim tick the chunk was last used in.
+    bool counted;
+    bool modified; // Differs from its stored copy, or from a fresh chunk if it has none.
+};
+
+class InfiniteBoard
+{
+public:
+    ~InfiniteBoard();
+    
+    // density is the share of cells that are mines. Modified chunks spill to spillPath once more than storeBytes
+    // of them are held in memory; an empty path keeps them all in memory.
+    ResultBool Init(uint64 seed, real64 density, uint32 residentChunks, MemorySize storeBytes, const std::string& spillPath);
+    // Starts over on a fresh plane drawn from seed.
+    void Reset(uint64 seed);
+    
+    uint64 Seed() const { return m_seed; }
+    real64 Density() const { return real64(m_chunkMines) / INFINITE_CHUNK_CELLS; }
+    GameState State() const { return m_state; }
+    uint64 RevealedCount() const { return m_revealed; }
+    
+    static bool InBounds(int64 r, int64 c) { return r >= -INFINITE_MAX_COORD && r < INFINITE_MAX_COORD && c >= -INFINITE_MAX_COORD && c < INFINITE_MAX_COORD; }
+    
+    // Reading a cell never creates its chunk, though it may load it back from the store.
+    bool IsMine(int64 r, int64 c) { return Get(PLANE_MINE, r, c); }
+    bool IsRevealed(int64 r, int64 c) { return Get(PLANE_REVEALED, r, c); }
+    bool IsFlagged(int64 r, int64 c) { return Get(PLANE_FLAGGED, r, c); }
+    bool IsGuessed(int64 r, int64 c) { return Get(PLANE_GUESSED, r, c); }
+    bool IsExploded(int64 r, int64 c) const { return m_state == GAME_LOST && m_exploded.row == r && m_exploded.col == c; }
+    uint8 MinesNearby(int64 r, int64 c);
+    
+    // Same moves as Board; Changed() lists the cells the last one changed.
+    MoveResult Reveal(int64 r, int64 c);
+    MoveResult Chord(int64 r, int64 c);
+    void CycleMark(int64 r, int64 c);
+    const std::vector<InfiniteCell>& Changed() const { return m_changed; }
+    
+    // Evicts the least recently used chunks beyond the resident limit; chunks used since the last Trim stay.
+    // Call it between frames, so everything on screen was used since.
+    void Trim();
+    uint32 ResidentChunks() const { return uint32(m_index.size()); }
+    MemorySize StoredChunks() const { return m_stored.size(); }
+
+private:
+    // A compressed chunk: in memory in data, or on disk at offset once spilled.
+    struct StoredChunk
+    {
+        std::vector<uint8> data;
+        uint64 offset;
+        uint32 size;
+    };
+    
+    // Newly revealed empty cells of one chunk row word, waiting for Flood to reveal around them.
+    struct FloodItem
+    {
+        int32 cy;
+        int32 cx;
+        uint32 row;
+        uint64 bits;
+    };
+    
+    bool Get(BoardPlane p, int64 r, int64 c);
+    // Resident chunk, loaded from the store if it is there; nullptr if it was never touched.
+    InfiniteChunk* Find(int32 cy, int32 cx);
+    // Resident chunk, loaded or created as needed, with its neighbor counts worked out.
+    InfiniteChunk* Chunk(int32 cy, int32 cx);
+    InfiniteChunk* Allocate(int32 cy, int32 cx);
+    void GenerateMines(int32 cy, int32 cx, uint64 mines[INFINITE_CHUNK_SIZE]) const;
+    void Count(InfiniteChunk& chunk);
+    void Evict(uint32 slot);
+    void Store(const InfiniteChunk& chunk);
+    bool Load(InfiniteChunk& chunk, const StoredChunk& stored);
+    void Spill();
+    
+    MoveResult RevealCell(int64 r, int64 c);
+    // Reveals the covered, unflagged cells of mask in row (which may be -1 or INFINITE_CHUNK_SIZE, i.e. in the chunk
+    // above or below) of chunk (cy, cx), and queues the new empty ones for Flood if queue is set.
+    void RevealSafeWord(int32 cy, int32 cx, int32 row, uint64 mask, bool queue);
+    void Flood(MemoryIndex first);
+    
+    uint64 m_seed = 0;
+    uint32 m_chunkMines = 0;
+    uint32 m_residentLimit = INFINITE_DEFAULT_RESIDENT;
+    MemorySize m_storeLimit = INFINITE_DEFAULT_STORE;
+    GameState m_state = GAME_PLAYING;
+    InfiniteCell m_exploded = {0, 0};
+    uint64 m_revealed = 0;
+    uint64 m_tick = 0;
+    std::vector<InfiniteCell> m_changed;
+    std::vector<FloodItem> m_flood;
+    
+    std::vector<std::unique_ptr<InfiniteChunk>> m_chunks; // Slots; evicted ones are reused.
+    std::vector<uint32> m_freeSlots;
+    std::unordered_map<uint64, uint32> m_index; // Chunk key to slot.
+    // Last chunk looked up, which drawing and floods hit most of the time; m_lastSlot is UINT32_MAX when there is none.
+    uint64 m_lastKey = 0;
+    uint32 m_lastSlot = UINT32_MAX;
+    
+    std::unordered_map<uint64, StoredChunk> m_stored;
+    MemorySize m_storedBytes = 0; // Of the stored chunks still in memory.
+    std::string m_spillPath;
+    std::fstream m_spill;
+    uint64 m_spillSize = 0;
+};
+
+#endif
@@ -0,0 +1,198 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+#include "log.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg> // va_list
+#include <cstdio> // vsnprintf, FILE
+#include <mutex>
+#include <thread>
+
+
+static_assert((LOG_RING_SLOTS & (LOG_RING_SLOTS - 1)) == 0, "LOG_RING_SLOTS must be a power of two.");
+
+// One line; a slot is free for position p when sequence == p and holds the line for p when sequence == p + 1.
+struct alignas(64) LogSlot
+{
+    std::atomic<uint64> sequence;
+    uint32 level;
+    uint32 length;
+    char text[LOG_LINE_SIZE];
+};
+
+static LogSlot g_logSlots[LOG_RING_SLOTS];
+static std::atomic<uint64> g_logHead{0}; // Next position to claim; shared by every producer.
+static uint64 g_logTail = 0; // Next position to write; only the writer thread touches it.
+static std::atomic<uint64> g_logDropped{0};
+static std::atomic<bool> g_logRunning{false};
+static std::thread g_logThread;
+static std::mutex g_logWakeMutex;
+static std::condition_variable g_logWake;
+static FILE* g_logFile = nullptr;
+static bool g_logStderr = false;
+
+static const char* const LOG_PREFIXES[] = {"", "Warning: ", "Failure: "};
+
+static void InitSlots()
+{
+    for (uint64 i = 0; i < LOG_RING_SLOTS; i++)
+        g_logSlots[i].sequence.store(i, std::memory_order_relaxed);
+    g_logHead.store(0, std::memory_order_relaxed);
+    g_logTail = 0;
+}
+
+// Where lines go without a log file.
+static FILE* ConsoleFile()
+{
+    return (g_logStderr ? stderr : stdout);
+}
+
+// Length of a line vsnprintf'd into LOG_LINE_SIZE bytes; a cut line ends in "..." so it is not mistaken for a whole one.
+static uint32 ClampLength(char* text, int length)
+{
+    if (length < 0)
+        return 0;
+    if (length < LOG_LINE_SIZE)
+        return uint32(length);
+    std::memcpy(text + LOG_LINE_SIZE - 4, "...", 3);
+    return LOG_LINE_SIZE - 1;
+}
+
+static void WriteLine(FILE* file, uint32 level, const char* text, uint32 length)
+{
+    std::fputs(LOG_PREFIXES[level], file);
+    std::fwrite(text, 1, length, file);
+    std::fputc('\n', file);
+}
+
+// Writes every published line; returns false if there was nothing to write.
+static bool Drain()
+{
+    bool wrote = false;
+    for (;;)
+    {
+        LogSlot& slot = g_logSlots[g_logTail & (LOG_RING_SLOTS - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != g_logTail + 1)
+            break;
+        WriteLine(g_logFile, slot.level, slot.text, slot.length);
+        slot.sequence.store(g_logTail + LOG_RING_SLOTS, std::memory_order_release);
+        g_logTail++;
+        wrote = true;
+    }
+    
+    uint64 dropped = g_logDropped.exchange(0, std::memory_order_relaxed);
+    if (dropped)
+    {
+        std::fprintf(g_logFile, "Warning: Log ring full, dropped %" PRIu64 " lines.\n", dropped);
+        wrote = true;
+    }
+    if (wrote)
+        std::fflush(g_logFile);
+    return wrote;
+}
+
+static void WriterThread()
+{
+    while (g_logRunning.load(std::memory_order_acquire))
+    {
+        if (Drain())
+            continue;
+        // Producers notify without taking the lock, so a wakeup can be missed; the timeout bounds how late a line is.
+        std::unique_lock<std::mutex> lock(g_logWakeMutex);
+        g_logWake.wait_for(lock, std::chrono::milliseconds(100));
+    }
+    Drain();
+}
+
+void LogWrite(uint32 level, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    
+    if (!g_logRunning.load(std::memory_order_acquire))
+    {
+        char text[LOG_LINE_SIZE];
+        int length = std::vsnprintf(text, sizeof(text), format, args);
+        va_end(args);
+        if (length >= 0)
+            WriteLine(ConsoleFile(), level, text, ClampLength(text, length));
+        return;
+    }
+    
+    // Claim a slot (bounded MPMC queue, Vyukov); a full ring drops the line instead of waiting.
+    LogSlot* slot = nullptr;
+    uint64 pos = g_logHead.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        slot = &g_logSlots[pos & (LOG_RING_SLOTS - 1)];
+        int64 diff = int64(slot->sequence.load(std::memory_order_acquire) - pos);
+        if (diff == 0)
+        {
+            if (g_logHead.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            va_end(args);
+            g_logDropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        else
+        {
+            pos = g_logHead.load(std::memory_order_relaxed);
+        }
+    }
+    
+    int length = std::vsnprintf(slot->text, LOG_LINE_SIZE, format, args);
+    va_end(args);
+    slot->level = level;
+    slot->length = ClampLength(slot->text, length);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    g_logWake.notify_one();
+}
+
+ResultBool LogStart(const std::string& path)
+{
+    ResultBool ret = {false, ""};
+    LogStop();
+    
+    g_logFile = (path.empty() ? ConsoleFile() : std::fopen(path.c_str(), "a"));
+    if (!g_logFile)
+    {
+        g_logFile = nullptr;
+        ret.error = "Failed to open log file " + path + ".";
+        return ret;
+    }
+    
+    InitSlots();
+    g_logRunning.store(true, std::memory_order_release);
+    g_logThread = std::thread(WriterThread);
+    
+    ret.result = true;
+    return ret;
+}
+
+void LogStop()
+{
+    if (!g_logThread.joinable())
+        return;
+    
+    g_logRunning.store(false, std::memory_order_release);
+    g_logWake.notify_one();
+    g_logThread.join();
+    if (g_logFile != stdout && g_logFile != stderr)
+        std::fclose(g_logFile);
+    g_logFile = nullptr;
+}
+
+void LogUseStderr()
+{
+    g_logStderr = true;
+}
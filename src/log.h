@@ -0,0 +1,77 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+#ifndef LOG_H
+#define LOG_H
+
+#include "common.h"
+
+#include <cinttypes> // PRIu64
+
+
+/*
+    printf-style logging into a fixed ring of preallocated lines.
+
+    LOG_INFO/LOG_WARN/LOG_FAIL format straight into a ring slot: no allocation, no lock and no I/O on the
+    calling thread. After LogStart a background thread writes the lines out; before it (and in tools that never
+    call it) lines are written synchronously. When the ring is full the line is dropped and counted, so a
+    flood of messages never stalls the render or audio thread.
+
+    Levels below LOG_LEVEL (set with the MINESWEEPER_LOG_LEVEL CMake option) are compiled out entirely;
+    their arguments are not even evaluated.
+*/
+
+#define LOG_LEVEL_INFO 0
+#define LOG_LEVEL_WARN 1
+#define LOG_LEVEL_FAIL 2
+#define LOG_LEVEL_NONE 3
+
+#ifndef LOG_LEVEL
+    #define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// Longest line kept, including the terminator; longer lines are cut and end in "...".
+#define LOG_LINE_SIZE 240
+// Lines the ring holds before it starts dropping; a power of two.
+#define LOG_RING_SLOTS 1024
+
+#if defined(COMPILER_CLANG) || defined(COMPILER_GCC) || defined(COMPILER_MINGW)
+    #define LOG_FORMAT_CHECK(f, a) __attribute__((format(printf, f, a)))
+#else
+    #define LOG_FORMAT_CHECK(f, a)
+#endif
+
+void LogWrite(uint32 level, const char* format, ...) LOG_FORMAT_CHECK(2, 3);
+// A compiled out line: sizeof never evaluates it, but its format is still checked and its arguments still count as used.
+#define LOG_DISCARD(...) ((void)sizeof((LogWrite(__VA_ARGS__), 0)))
+
+// Starts the writer thread; path is a file to append to, or empty for stdout.
+ResultBool LogStart(const std::string& path);
+// Writes the lines meant for stdout to stderr instead, for tools whose stdout carries their output.
+void LogUseStderr();
+// Writes every queued line and stops the writer thread; later lines are written synchronously again.
+void LogStop();
+
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+    #define LOG_INFO(...) LogWrite(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+    #define LOG_INFO(...) LOG_DISCARD(LOG_LEVEL_INFO, __VA_ARGS__)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_WARN
+    #define LOG_WARN(...) LogWrite(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+    #define LOG_WARN(...) LOG_DISCARD(LOG_LEVEL_WARN, __VA_ARGS__)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_FAIL
+    #define LOG_FAIL(...) LogWrite(LOG_LEVEL_FAIL, __VA_ARGS__)
+#else
+    #define LOG_FAIL(...) LOG_DISCARD(LOG_LEVEL_FAIL, __VA_ARGS__)
+#endif
+
+#endif
@@ -5,99 +5,41 @@
     ====================================
 */
 
-#if defined(_WIN32) || defined(_WIN64)
-    #define OS_WINDOWS 1
-#elif defined(__linux__)
-    #define OS_LINUX 1
-#else
-    #error Unknown OS.
-#endif
-
-#if defined(__clang__)
-    #define COMPILER_CLANG 1
-#elif defined(__GNUC__)
-    #define COMPILER_GCC 1
-#elif defined(__MINGW32__) || defined(__MINGW64__)
-    #define COMPILER_MINGW 1
-#elif defined(_MSC_VER)
-    #define COMPILER_VISUAL_C
-#else
-    #error Unknown Compiler.
-#endif
-
-#if defined(COMPILER_CLANG) || defined(COMPILER_GCC) || defined(COMPILER_MINGW)
-    #if defined(__i386__)
-        #define ARCH_X86
-    #elif defined(__x86_64__)
-        #define ARCH_X64
-    #else
-        #error Unknown CPU Architecture.
-    #endif
-#elif defined(COMPILER_VISUAL_C)
-    #if defined(_M_IX86)
-        #define ARCH_X86
-    #elif defined(_M_X64)
-        #define ARCH_X64
-    #else
-        #error Unknown CPU Architecture.
-    #endif
-#else
-    #error Unknown Compiler.
-#endif
-
-
-#include <cstddef> // (u)int(8/16/32/64)_t
-#include <cstdint> // size_t
-#include <cstring> // memset
-#include <string>  // string
+#include "common.h"
+#include "args.h"
+#include "board.h"
+#include "bundle.h"
+#include "generator.h"
+#include "infinite.h"
+#include "log.h"
+#include "mixer.h"
+#include "probability.h"
+#include "profile.h"
+#include "random.h"
+#include "replay.h"
+#include "save.h"
+#include "solver.h"
 
 #include <SDL.h>
+// Older releases implement SDL_WaitEventTimeout as a 1 ms pump loop, so an idle game would never sleep.
+#if !SDL_VERSION_ATLEAST(2, 0, 16)
+    #error SDL2 2.0.16 or newer is required.
+#endif
 #ifdef OS_WINDOWS
     #define WIN32_LEAN_AND_MEAN
     #include <windows.h>
 #endif
+#include <algorithm> // min
+#include <cstdio> // snprintf, printf
 #include <exception> // exception
 #include <fstream>
+#include <future> // async, future
 #include <iostream>
-#include <sstream>
-#include <cstdlib> // srand, rand
 #include <ctime> // time
+#include <random> // random_device
 #include <cmath> // floor
-
-
-#define KIBIBYTES(v) ((v) * 1024LL)
-#define MEBIBYTES(v) (KIBIBYTES(v) * 1024LL)
-#define GIBIBYTES(v) (MEBIBYTES(v) * 1024LL)
-
-#define ARRAY_COUNT(a) (sizeof(a) / sizeof((a)[0]))
-
-#define ZERO_STRUCT(s) std::memset(&(s), 0, sizeof(s))
-
-
-typedef std::int8_t int8;
-typedef std::int16_t int16;
-typedef std::int32_t int32;
-typedef std::int64_t int64;
-
-typedef std::uint8_t uint8;
-typedef std::uint16_t uint16;
-typedef std::uint32_t uint32;
-typedef std::uint64_t uint64;
-
-typedef float real32;
-typedef double real64;
-
-typedef std::size_t MemoryIndex;
-typedef std::size_t MemorySize;
-
-
-struct ResultBool
-{
-    bool result;
-    std::string error;
-    
-    explicit operator bool() const { return result; }
-};
+#include <utility> // swap
+#include <vector>
 
 
 
@@ -153,12 +95,16 @@ struct ResultBool
         }
     }
 #else
-    #error Only Windows is supported right now.
-#endif
+    // Only Windows checks for a second instance so far; elsewhere the game always starts, e.g. --offscreen on CI.
+    bool VerifySingleInstanceInit()
+    {
+        return true;
+    }
 
-#define LOG_INFO(msg) std::cout << (msg) << "\n";
-#define LOG_WARN(msg) std::cout << "Warning: " << (msg) << "\n";
-#define LOG_FAIL(msg) std::cout << "Failure: " << (msg) << "\n";
+    void VerifySingleInstanceCleanup()
+    {
+    }
+#endif
 
 
 #if 1
@@ -167,156 +113,270 @@ struct ResultBool
     static std::string g_dataPath = "data/";
 #endif
 
-std::stringstream ss;
+
+#define IMAGE_WIDTH 15
+#define IMAGE_HEIGHT IMAGE_WIDTH
+// Tiles are square; each zoom level draws them at one of these sizes in pixels, IMAGE_WIDTH being the images' own.
+static const uint32 ZOOM_TILE_SIZES[] = {3, 5, 8, 11, IMAGE_WIDTH, 20, 30, 45};
+#define ZOOM_LEVELS ARRAY_COUNT(ZOOM_TILE_SIZES)
+#define DEFAULT_ZOOM 4
+// Largest share of the display's usable area the window starts at; bigger boards scroll.
+#define WINDOW_SCREEN_FRACTION 0.9
+// Share of the view one arrow key press pans by.
+#define PAN_FRACTION 0.25
+// Modified chunks of the infinite board spill here; it is deleted at exit.
+#define INFINITE_SPILL_FILE "minesweeper.chunks"
+// The heat map tints covered cells in this many steps from green (never a mine) to red (always one).
+#define HEAT_LEVELS 8
+#define HEAT_ALPHA 112
+// Frame rate cap when the display's refresh rate is unknown and no --fps limit was given.
+#define DEFAULT_FPS 60
+// Largest view --offscreen renders; smaller boards get a view their own size, like the window.
+#define OFFSCREEN_MAX_WIDTH 1280
+#define OFFSCREEN_MAX_HEIGHT 720
 
 /*
-    Game modes:
-        Beginner: 10 mines @ 8x8, 9x9, or 10x10.
-        Intermediate: 40 mines @ 13x15 or 16x16.
-        Expert: 99 mines @ 16x30 or 30x16.
+    Every tile lives in one atlas texture, one IMAGE_WIDTH column per tile.
+    The number tiles come first so a revealed cell's tile is its neighboring mine count.
 */
+enum Tile
+{
+    TILE_0, TILE_1, TILE_2, TILE_3, TILE_4, TILE_5, TILE_6, TILE_7, TILE_8,
+    TILE_FLAG,
+    TILE_GUESS,
+    TILE_PRESSED,
+    TILE_RAISED,
+    TILE_EXPLODED,
+    TILE_COUNT
+};
 
-#define NUM_COLS 30
-#define NUM_ROWS 16
-#define NUM_MINES 99
-#define IMAGE_WIDTH 15
-#define IMAGE_HEIGHT IMAGE_WIDTH
-#define WINDOW_WIDTH IMAGE_WIDTH*NUM_COLS
-#define WINDOW_HEIGHT IMAGE_HEIGHT*NUM_ROWS
+static const char* const TILE_FILES[TILE_COUNT] =
+{
+    "0.bmp", "1.bmp", "2.bmp", "3.bmp", "4.bmp", "5.bmp", "6.bmp", "7.bmp", "8.bmp",
+    "flag.bmp", "guess.bmp", "pressed.bmp", "raised.bmp", "mine.bmp"
+};
+
+// Cell state bits used to index g_tiles.
+#define TILE_STATE_PRESSED 1
+#define TILE_STATE_GUESSED 2
+#define TILE_STATE_FLAGGED 4
+#define TILE_STATE_REVEALED 8
+#define TILE_STATE_EXPLODED 16
 
 static SDL_Window* g_window = nullptr;
-static SDL_Surface* g_screenSurface = nullptr;
-static SDL_Surface* g_0Surface = nullptr;
-static SDL_Surface* g_1Surface = nullptr;
-static SDL_Surface* g_2Surface = nullptr;
-static SDL_Surface* g_3Surface = nullptr;
-static SDL_Surface* g_4Surface = nullptr;
-static SDL_Surface* g_5Surface = nullptr;
-static SDL_Surface* g_6Surface = nullptr;
-static SDL_Surface* g_7Surface = nullptr;
-static SDL_Surface* g_8Surface = nullptr;
-static SDL_Surface* g_flagSurface = nullptr;
-static SDL_Surface* g_guessSurface = nullptr;
-static SDL_Surface* g_pressedSurface = nullptr;
-static SDL_Surface* g_raisedSurface = nullptr;
-static SDL_Surface* g_explodedSurface = nullptr;
-static SDL_AudioSpec g_explodeAudioSpec;
-static uint8* g_explodeAudioBuf = nullptr;
-static uint32 g_explodeAudioLen = 0;
-static SDL_AudioSpec g_revealAudioSpec;
-static uint8* g_revealAudioBuf = nullptr;
-static uint32 g_revealAudioLen = 0;
-static SDL_AudioDeviceID g_audioDevice;
-
-
-struct Cell
-{
-    bool isMine = false;
-    bool isRevealed = false;
-    bool isFlagged = false;
-    bool isGuessed = false;
-    bool isExploded = false; // Player clicked the mine and lost.
-    bool isPressed = false; // Player is holding left-click on this cell or is using middle-click.
-    uint32 minesNearby = 0;
-};
+static SDL_Renderer* g_renderer = nullptr;
+static SDL_Texture* g_atlasTexture = nullptr;
+// Render target the size of the window holding the visible cells; only dirty cells are redrawn into it.
+static SDL_Texture* g_viewTexture = nullptr;
+static int32 g_viewWidth = 0;
+static int32 g_viewHeight = 0;
+// The atlas scaled to each zoom level, made the first time the level is drawn; the native size uses g_atlasTexture.
+static SDL_Texture* g_zoomAtlases[ZOOM_LEVELS];
+static uint8 g_tiles[32]; // Tile for every combination of TILE_STATE_* bits; revealed cells add their count to it.
+static std::vector<SDL_Rect> g_tileSrc;
+static std::vector<SDL_Rect> g_tileDst;
+static Mixer g_mixer;
+static uint32 g_audioFrames = MIXER_DEFAULT_FRAMES; // Audio device buffer size; smaller is lower latency.
+static Sound g_explodeSound;
+static Sound g_revealSound;
+static std::vector<float> g_explodeSamples; // Converted samples when loaded from a loose file.
+static std::vector<float> g_revealSamples;
+static Bundle g_bundle; // Packed assets; when it is not open they are loaded from loose files instead.
+
 
-static Cell g_cells[NUM_ROWS][NUM_COLS];
+static GameMode g_gameMode = GAME_MODE_EXPERT;
+static Board g_board;
+static Board g_nextBoard; // Next game's board, generated on another thread while this one is played.
+static std::future<void> g_nextBoardReady;
+static uint64 g_nextSeed = 0; // Seed g_nextBoard is generated from.
+static bool g_noGuess = false; // New games come from g_noGuessGenerator instead of g_rng.
+static NoGuessGenerator g_noGuessGenerator;
+static bool g_infinite = false; // Play g_infiniteBoard, at the game mode's mine density, instead of g_board.
+static InfiniteBoard g_infiniteBoard;
+// Player is holding left-click on this cell.
+static bool g_pressed = false;
+static int64 g_pressedRow = 0;
+static int64 g_pressedCol = 0;
+static bool g_seedSet = false;
+static uint64 g_seed = 0; // Every board's seed is drawn from g_rng, which is seeded with this.
+static Random g_rng;
+static Solver g_solver; // Follows g_board so H can hint a provable move.
+static MineProbability g_probability;
+static bool g_heatMap = false; // P tints every covered cell by its chance of being a mine.
+static bool g_heatMapStale = true; // g_probability is out of date with g_board.
+static std::vector<SDL_Rect> g_heatRects[HEAT_LEVELS]; // Queued like the tiles, one batch per tint.
+// Cells to redraw next frame; g_dirtyFlags has one byte per cell so each is listed once.
+static std::vector<uint32> g_dirty;
+static std::vector<uint8> g_dirtyFlags;
+static bool g_dirtyAll = true; // Redraw every visible cell, e.g. for a new board, a pan or when the window was exposed.
+// Board pixel, at the current zoom level, drawn at the view's top left corner; negative when the board is smaller than the view.
+static int64 g_cameraX = 0;
+static int64 g_cameraY = 0;
+static uint32 g_zoom = DEFAULT_ZOOM; // Index into ZOOM_TILE_SIZES.
+static uint32 g_fpsLimit = 0; // Most frames drawn per second; 0 follows the display's refresh rate.
+static std::string g_logPath; // Log file to append to; empty logs to stdout.
+static bool g_profile = false; // Time the hot paths and log their latencies at exit.
+static std::string g_tracePath; // Chrome trace written at exit; empty writes none.
+static std::string g_recordPath; // Every input is recorded here; empty records nothing.
+static std::string g_replayPath; // Recording to play back instead of taking clicks; empty plays live.
+static InputRecorder g_recorder;
+static InputReplay g_replay;
+static InputEvent g_replayNext; // Next input of g_replay, valid while g_replayPending.
+static bool g_replayPending = false;
+static std::string g_savePath = SAVE_DEFAULT_FILE; // F5 saves here and F9 loads from here.
+static bool g_loadAtStart = false; // Start from g_savePath instead of a new board.
+static uint32 g_inputStart = 0; // SDL_GetTicks() when the first board was dealt; input times count from here.
+// --offscreen <frames>: render that many frames of a scripted game into g_offscreenPixels, with no window, and exit.
+static uint32 g_offscreenFrames = 0;
+static bool g_offscreenFull = false; // Redraw the whole view every offscreen frame instead of only the dirty cells.
+static std::vector<uint32> g_offscreenPixels; // ARGB8888, g_viewWidth pixels per row.
+static SDL_Surface* g_offscreenSurface = nullptr; // Wraps g_offscreenPixels for the software renderer.
+static std::string g_snapshotPrefix; // Offscreen frames are saved as <prefix><frame>.bmp; empty saves none.
+static uint32 g_snapshotEvery = 0; // Offscreen frames between snapshots; 0 saves only the last.
+static std::string g_frameTimesPath; // Each offscreen frame's drawing time is written here; empty writes none.
 
 
-bool RandBool()
+void MarkDirty(uint32 cell)
 {
-    if ((std::rand() % 2 + 1) == 1)
-        return false;
+    if (cell == BOARD_NO_CELL || g_dirtyFlags[cell])
+        return;
+    g_dirtyFlags[cell] = 1;
+    g_dirty.push_back(cell);
+}
+
+// Marks every cell the board's last move changed.
+void MarkChanged()
+{
+    for (uint32 cell : g_board.Changed())
+        MarkDirty(cell);
+}
+
+// The infinite board has no per-cell dirty flags; its changes redraw the view, which costs about as much as a full one.
+void MarkCellDirty(int64 r, int64 c)
+{
+    if (g_infinite)
+        g_dirtyAll = true;
     else
-        return true;
+        MarkDirty(g_board.Index(uint32(r), uint32(c)));
+}
+
+void SetPressedCell(bool pressed, int64 r, int64 c)
+{
+    if (g_pressed)
+        MarkCellDirty(g_pressedRow, g_pressedCol);
+    g_pressed = pressed;
+    g_pressedRow = r;
+    g_pressedCol = c;
+    if (g_pressed)
+        MarkCellDirty(g_pressedRow, g_pressedCol);
+}
+
+void CenterCamera();
+
+/*
+    Starts generating the next game's board, the size of the current one, on another thread. Its seed is drawn
+    right away, so every board still takes the same number from g_rng as NewGame would give it and recordings
+    replay the same boards.
+*/
+void PrepareNextBoard()
+{
+    g_nextSeed = g_rng.Next();
+    uint32 rows = g_board.Rows();
+    uint32 cols = g_board.Cols();
+    uint32 mines = g_board.Mines();
+    uint64 seed = g_nextSeed;
+    g_nextBoardReady = std::async(std::launch::async, [rows, cols, mines, seed]()
+    {
+        // The size is that of a valid board, so Init cannot fail.
+        if (g_nextBoard.Rows() != rows || g_nextBoard.Cols() != cols || g_nextBoard.Mines() != mines)
+            g_nextBoard.Init(rows, cols, mines);
+        g_nextBoard.Generate(seed);
+    });
 }
 
 void InitCells()
 {
-    uint32 mineCount = 0;
-    for (uint32 r = 0; r < NUM_ROWS; r++)
+    PROFILE_SCOPE(PROFILE_INIT_CELLS);
+    if (g_infinite)
     {
-        for (uint32 c = 0; c < NUM_COLS; c++)
-        {
-            g_cells[r][c].isMine = false;
-            g_cells[r][c].isRevealed = false;
-            g_cells[r][c].isFlagged = false;
-            g_cells[r][c].isGuessed = false;
-            g_cells[r][c].isExploded = false;
-            g_cells[r][c].isPressed = false;
-            g_cells[r][c].minesNearby = 0;
-            
-            if (mineCount < NUM_MINES && RandBool() == 1)
-            {
-                g_cells[r][c].isMine = true;
-                mineCount++;
-            }
-        }
+        g_infiniteBoard.Reset(g_rng.Next());
+        CenterCamera();
+        LOG_INFO("Board seed: %" PRIu64, g_infiniteBoard.Seed());
+        return;
     }
     
-    for (uint32 r = 0; r < NUM_ROWS; r++)
+    if (g_noGuess && g_noGuessGenerator.Take(g_board, NO_GUESS_WAIT_MS))
+    {
+        // Pooled boards come opened; the solver picks the opening up.
+        g_solver.Reset(g_board);
+    }
+    else if (g_nextBoardReady.valid())
     {
-        for (uint32 c = 0; c < NUM_COLS; c++)
+        g_nextBoardReady.get();
+        std::swap(g_board, g_nextBoard);
+        // A save loaded since (F9) may be another size; new games keep to the loaded one.
+        if (g_board.Rows() != g_nextBoard.Rows() || g_board.Cols() != g_nextBoard.Cols() || g_board.Mines() != g_nextBoard.Mines())
         {
-            // left
-            if (c > 0 && g_cells[r][c-1].isMine)
-                g_cells[r][c].minesNearby++;
-            
-            // topleft
-            if (r > 0 && c > 0 && g_cells[r-1][c-1].isMine)
-                g_cells[r][c].minesNearby++;
-            
-            // top
-            if (r > 0 && g_cells[r-1][c].isMine)
-                g_cells[r][c].minesNearby++;
-            
-            // topright
-            if (r > 0 && c < (NUM_COLS-1) && g_cells[r-1][c+1].isMine)
-                g_cells[r][c].minesNearby++;
-            
-            // right
-            if (c < (NUM_COLS-1) && g_cells[r][c+1].isMine)
-                g_cells[r][c].minesNearby++;
-            
-            // bottomright
-            if (r < (NUM_ROWS-1) && c < (NUM_COLS-1) && g_cells[r+1][c+1].isMine)
-                g_cells[r][c].minesNearby++;
-            
-            // bottom
-            if (r < (NUM_ROWS-1) && g_cells[r+1][c].isMine)
-                g_cells[r][c].minesNearby++;
-            
-            // bottomleft
-            if (r < (NUM_ROWS-1) && c > 0 && g_cells[r+1][c-1].isMine)
-                g_cells[r][c].minesNearby++;
+            g_board.Init(g_nextBoard.Rows(), g_nextBoard.Cols(), g_nextBoard.Mines());
+            g_board.Generate(g_nextSeed);
         }
+        g_solver.Reset(g_board);
+    }
+    else
+    {
+        if (g_noGuess)
+            LOG_WARN("No no-guess board was ready within %d ms; dealt an ordinary one.", NO_GUESS_WAIT_MS);
+        NewGame(g_board, g_solver, g_rng);
     }
+    if (!g_noGuess)
+        PrepareNextBoard();
+    g_dirtyAll = true;
+    g_heatMapStale = true;
+    LOG_INFO("Board seed: %" PRIu64, g_board.Seed());
+}
+
+GameState CurrentState()
+{
+    return (g_infinite ? g_infiniteBoard.State() : g_board.State());
 }
 
 bool LoadImage(std::string file, SDL_Surface*& surface)
 {
+    // Bundled pixels are already ARGB8888, so the surface just points into the mapping.
+    const BundleEntry* entry = g_bundle.Find(file, BUNDLE_IMAGE);
+    if (entry && (entry->format != SDL_PIXELFORMAT_ARGB8888 || entry->width != IMAGE_WIDTH || entry->height != IMAGE_HEIGHT))
+    {
+        LOG_WARN("Bundled image %s is not a %dx%d ARGB8888 tile; loading the loose file.", file.c_str(), IMAGE_WIDTH, IMAGE_HEIGHT);
+        entry = nullptr;
+    }
+    if (entry)
+    {
+        surface = SDL_CreateRGBSurfaceWithFormatFrom(const_cast<uint8*>(g_bundle.Data(*entry)), int(entry->width), int(entry->height),
+                                                     32, int(entry->width * 4), entry->format);
+        if (!surface)
+        {
+            LOG_FAIL("Failed to use bundled image: %s: %s", file.c_str(), SDL_GetError());
+            return false;
+        }
+        return true;
+    }
+    
     std::string f = g_dataPath + file;
     const char* s = f.c_str();
     SDL_Surface* t = SDL_LoadBMP(s);
     if (!t)
     {
-        ss.str("");
-        ss << "Failed to load image: " << f << SDL_GetError();
-        LOG_FAIL(ss.str());
+        LOG_FAIL("Failed to load image: %s: %s", f.c_str(), SDL_GetError());
         return false;
     }
-    ss.str("");
-    ss << "Loaded image: " << f;
-    LOG_INFO(ss.str())
+    LOG_INFO("Loaded image: %s", f.c_str());
     surface = t;
     
-    surface = SDL_ConvertSurface(t, g_screenSurface->format, 0);
+    surface = SDL_ConvertSurfaceFormat(t, SDL_PIXELFORMAT_ARGB8888, 0);
     if (!surface)
     {
         SDL_FreeSurface(t); t = nullptr;
-        ss.str("");
-        ss << "Failed to optimize image: " << SDL_GetError();
-        LOG_FAIL(ss.str());
+        LOG_FAIL("Failed to optimize image: %s", SDL_GetError());
         return false;
     }
     SDL_FreeSurface(t); t = nullptr;
@@ -325,435 +385,1347 @@ bool LoadImage(std::string file, SDL_Surface*& surface)
     return true;
 }
 
-bool LoadAudio(std::string file, SDL_AudioSpec* spec, uint8* buf, uint32* len)
+// Bundled samples are used where they are mapped; a loose WAV is converted into samples, which sound then points at.
+bool LoadAudio(std::string file, Sound& sound, std::vector<float>& samples)
 {
+    const BundleEntry* entry = g_bundle.Find(file, BUNDLE_AUDIO);
+    if (entry && (entry->format != AUDIO_F32SYS || entry->width != BUNDLE_AUDIO_FREQUENCY || entry->height != BUNDLE_AUDIO_CHANNELS))
+    {
+        LOG_WARN("Bundled sound %s is not %d Hz %d channel float; loading the loose file.", file.c_str(), BUNDLE_AUDIO_FREQUENCY, BUNDLE_AUDIO_CHANNELS);
+        entry = nullptr;
+    }
+    if (entry)
+    {
+        sound.samples = reinterpret_cast<const float*>(g_bundle.Data(*entry));
+        sound.frames = uint32(entry->size / (sizeof(float) * BUNDLE_AUDIO_CHANNELS));
+        return true;
+    }
+    
     std::string f = g_dataPath + file;
     const char* s = f.c_str();
-    if (SDL_LoadWAV(s, spec, &buf, len) == nullptr)
+    SDL_AudioSpec spec;
+    uint8* buf = nullptr;
+    uint32 len = 0;
+    if (SDL_LoadWAV(s, &spec, &buf, &len) == nullptr)
     {
-        ss.str("");
-        ss << "Failed to load audio: " << f << SDL_GetError();
-        LOG_FAIL(ss.str());
+        LOG_FAIL("Failed to load audio: %s: %s", f.c_str(), SDL_GetError());
         return false;
     }
-    ss.str("");
-    ss << "Loaded audio: " << f;
-    LOG_INFO(ss.str())
-    
-    return true;
-}
-
-bool PlayRevealAudio()
-{
-    if (SDL_QueueAudio(g_audioDevice, g_revealAudioBuf, g_revealAudioLen) != 0)
+    ResultBool converted = ConvertWav(spec, buf, len, samples);
+    SDL_FreeWAV(buf); buf = nullptr;
+    if (!converted)
     {
-        ss.str("");
-        ss << "Failed to play reveal audio: " << SDL_GetError();
-        LOG_FAIL(ss.str());
+        LOG_FAIL("%s: %s", f.c_str(), converted.error.c_str());
         return false;
     }
+    LOG_INFO("Loaded audio: %s", f.c_str());
     
+    sound.samples = samples.data();
+    sound.frames = uint32(samples.size() / BUNDLE_AUDIO_CHANNELS);
     return true;
 }
 
-bool PlayExplodeAudio()
+void PlayRevealAudio()
+{
+    g_mixer.Play(g_revealSound);
+}
+
+void PlayExplodeAudio()
+{
+    g_mixer.Play(g_explodeSound);
+}
+
+/*
+    Uses the best available renderer and falls back to SDL's software renderer on machines without a GPU.
+    Batching lets SDL merge a frame's tile copies into as few driver calls as the backend allows.
+*/
+bool CreateRenderer()
 {
-    if (SDL_QueueAudio(g_audioDevice, g_explodeAudioBuf, g_explodeAudioLen) != 0)
+    SDL_SetHint(SDL_HINT_RENDER_BATCHING, "1");
+    g_renderer = SDL_CreateRenderer(g_window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE);
+    if (!g_renderer)
+        g_renderer = SDL_CreateRenderer(g_window, -1, SDL_RENDERER_SOFTWARE | SDL_RENDERER_TARGETTEXTURE);
+    if (!g_renderer)
     {
-        ss.str("");
-        ss << "Failed to play reveal audio: " << SDL_GetError();
-        LOG_FAIL(ss.str());
+        LOG_FAIL("Failed to create renderer: %s", SDL_GetError());
         return false;
     }
     
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(g_renderer, &info) == 0)
+    {
+        LOG_INFO("Created renderer: %s", info.name);
+    }
+    
     return true;
 }
 
-bool AppInit()
+/*
+    --offscreen renders into a plain pixel buffer instead of a window: SDL's software renderer draws into any
+    SDL_Surface, here one wrapping g_offscreenPixels, so it needs no display or video driver and the frames can be
+    read back. Everything else, from the view texture to the zoom atlases, works as with a window.
+*/
+bool CreateOffscreenRenderer(int32 width, int32 height)
 {
-    if (!VerifySingleInstanceInit())
+    g_offscreenPixels.assign(MemorySize(width) * height, 0);
+    g_offscreenSurface = SDL_CreateRGBSurfaceWithFormatFrom(g_offscreenPixels.data(), width, height, 32, width * 4, SDL_PIXELFORMAT_ARGB8888);
+    if (!g_offscreenSurface)
+    {
+        LOG_FAIL("Failed to create offscreen surface: %s", SDL_GetError());
         return false;
+    }
     
-    if (SDL_Init(SDL_INIT_EVERYTHING) < 0)
+    SDL_SetHint(SDL_HINT_RENDER_BATCHING, "1");
+    g_renderer = SDL_CreateSoftwareRenderer(g_offscreenSurface);
+    if (!g_renderer)
     {
-        ss.str("");
-        ss << "Failed to initialize SDL: " << SDL_GetError();
-        LOG_FAIL(ss.str());
+        LOG_FAIL("Failed to create offscreen renderer: %s", SDL_GetError());
         return false;
     }
-    LOG_INFO("Initalized SDL.");
+    LOG_INFO("Created %dx%d offscreen renderer.", width, height);
     
-    g_window = SDL_CreateWindow("Minesweeper", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, WINDOW_WIDTH, WINDOW_HEIGHT, SDL_WINDOW_SHOWN);
-    if (!g_window)
+    return true;
+}
+
+uint32 TileSize()
+{
+    return ZOOM_TILE_SIZES[g_zoom];
+}
+
+// Keeps the board covering the view where it is big enough, and centered where it is not.
+// The infinite board only keeps the view inside its coordinate range.
+void ClampCamera()
+{
+    g_dirtyAll = true;
+    if (g_infinite)
     {
-        ss.str("");
-        ss << "Failed to create window: " << SDL_GetError();
-        LOG_FAIL(ss.str());
-        return false;
+        int64 limit = INFINITE_MAX_COORD * TileSize();
+        g_cameraX = std::max(-limit, std::min(g_cameraX, limit - g_viewWidth));
+        g_cameraY = std::max(-limit, std::min(g_cameraY, limit - g_viewHeight));
+        return;
     }
-    g_screenSurface = SDL_GetWindowSurface(g_window);
-    LOG_INFO("Created window.");
     
-    if (!LoadImage("0.bmp", g_0Surface))
-        return false;
-    if (!LoadImage("1.bmp", g_1Surface))
-        return false;
-    if (!LoadImage("2.bmp", g_2Surface))
-        return false;
-    if (!LoadImage("3.bmp", g_3Surface))
-        return false;
-    if (!LoadImage("4.bmp", g_4Surface))
-        return false;
-    if (!LoadImage("5.bmp", g_5Surface))
-        return false;
-    if (!LoadImage("6.bmp", g_6Surface))
-        return false;
-    if (!LoadImage("7.bmp", g_7Surface))
-        return false;
-    if (!LoadImage("8.bmp", g_8Surface))
-        return false;
-    if (!LoadImage("flag.bmp", g_flagSurface))
-        return false;
-    if (!LoadImage("guess.bmp", g_guessSurface))
-        return false;
-    if (!LoadImage("pressed.bmp", g_pressedSurface))
-        return false;
-    if (!LoadImage("raised.bmp", g_raisedSurface))
-        return false;
-    if (!LoadImage("mine.bmp", g_explodedSurface))
-        return false;
+    int64 boardWidth = int64(TileSize()) * g_board.Cols();
+    int64 boardHeight = int64(TileSize()) * g_board.Rows();
+    if (boardWidth <= g_viewWidth)
+        g_cameraX = -(g_viewWidth - boardWidth) / 2;
+    else
+        g_cameraX = std::max<int64>(0, std::min(g_cameraX, boardWidth - g_viewWidth));
+    if (boardHeight <= g_viewHeight)
+        g_cameraY = -(g_viewHeight - boardHeight) / 2;
+    else
+        g_cameraY = std::max<int64>(0, std::min(g_cameraY, boardHeight - g_viewHeight));
+}
+
+// Puts cell (0, 0) of the infinite board in the middle of the view.
+void CenterCamera()
+{
+    g_cameraX = (int64(TileSize()) - g_viewWidth) / 2;
+    g_cameraY = (int64(TileSize()) - g_viewHeight) / 2;
+    ClampCamera();
+}
+
+void PanCamera(int64 dx, int64 dy)
+{
+    g_cameraX += dx;
+    g_cameraY += dy;
+    ClampCamera();
+}
+
+// Zooms by steps levels, keeping the board point under the view pixel (x, y) where it is.
+void ZoomCamera(int32 steps, int32 x, int32 y)
+{
+    int32 zoom = std::max(0, std::min(int32(g_zoom) + steps, int32(ZOOM_LEVELS) - 1));
+    if (uint32(zoom) == g_zoom)
+        return;
     
-    if (!LoadAudio("explode.wav", &g_explodeAudioSpec, g_explodeAudioBuf, &g_explodeAudioLen))
-        return false;
-    if (!LoadAudio("reveal.wav", &g_revealAudioSpec, g_revealAudioBuf, &g_revealAudioLen))
+    real64 scale = real64(ZOOM_TILE_SIZES[zoom]) / real64(TileSize());
+    g_cameraX = int64(std::floor((g_cameraX + x) * scale)) - x;
+    g_cameraY = int64(std::floor((g_cameraY + y) * scale)) - y;
+    g_zoom = uint32(zoom);
+    ClampCamera();
+}
+
+// (Re)creates the view texture at the window's size; the camera keeps its board position.
+bool ResizeView()
+{
+    int width = 0;
+    int height = 0;
+    if (SDL_GetRendererOutputSize(g_renderer, &width, &height) != 0)
+    {
+        LOG_FAIL("Failed to get the window size: %s", SDL_GetError());
         return false;
+    }
+    width = std::max(width, 1);
+    height = std::max(height, 1);
+    if (g_viewTexture && width == g_viewWidth && height == g_viewHeight)
+        return true;
     
-    SDL_AudioSpec desiredAudio;
-    SDL_zero(desiredAudio);
-    desiredAudio.freq = 48000;
-    desiredAudio.format = AUDIO_F32;
-    desiredAudio.channels = 2;
-    desiredAudio.samples = 4096;
-    g_audioDevice = SDL_OpenAudioDevice(nullptr, 0, &desiredAudio, nullptr, SDL_AUDIO_ALLOW_ANY_CHANGE);
-    if (g_audioDevice == 0)
-    {
-        ss.str("");
-        ss << "Failed to open audio device: " << SDL_GetError();
-        LOG_FAIL(ss.str());
+    if (g_viewTexture)
+        SDL_DestroyTexture(g_viewTexture);
+    g_viewTexture = SDL_CreateTexture(g_renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, width, height);
+    if (!g_viewTexture)
+    {
+        LOG_FAIL("Failed to create view texture: %s", SDL_GetError());
         return false;
     }
-    SDL_PauseAudioDevice(g_audioDevice, 0);
-    LOG_INFO("Opened audio device.");
-    
-    InitCells();
-    LOG_INFO("Initialized board.");
-    
-    std::srand(std::time(nullptr));
-    LOG_INFO("Seeded random number generator.");
+    g_viewWidth = width;
+    g_viewHeight = height;
+    ClampCamera();
     
     return true;
 }
 
-void AppCleanup()
+void DestroyZoomAtlases()
 {
-    LOG_INFO("Cleaning up.");
-    
-    SDL_CloseAudioDevice(g_audioDevice);
-    
-    if (g_explodeAudioBuf)
-        SDL_FreeWAV(g_explodeAudioBuf); g_explodeAudioBuf = nullptr;
-    if (g_revealAudioBuf)
-        SDL_FreeWAV(g_revealAudioBuf); g_revealAudioBuf = nullptr;
-    
-    if (g_raisedSurface)
-        SDL_FreeSurface(g_raisedSurface); g_raisedSurface = nullptr;
-    if (g_pressedSurface)
-        SDL_FreeSurface(g_pressedSurface); g_pressedSurface = nullptr;
-    if (g_guessSurface)
-        SDL_FreeSurface(g_guessSurface); g_guessSurface = nullptr;
-    if (g_flagSurface)
-        SDL_FreeSurface(g_flagSurface); g_flagSurface = nullptr;
-    if (g_8Surface)
-        SDL_FreeSurface(g_8Surface); g_8Surface = nullptr;
-    if (g_7Surface)
-        SDL_FreeSurface(g_7Surface); g_7Surface = nullptr;
-    if (g_6Surface)
-        SDL_FreeSurface(g_6Surface); g_6Surface = nullptr;
-    if (g_5Surface)
-        SDL_FreeSurface(g_5Surface); g_5Surface = nullptr;
-    if (g_4Surface)
-        SDL_FreeSurface(g_4Surface); g_4Surface = nullptr;
-    if (g_3Surface)
-        SDL_FreeSurface(g_3Surface); g_3Surface = nullptr;
-    if (g_2Surface)
-        SDL_FreeSurface(g_2Surface); g_2Surface = nullptr;
-    if (g_1Surface)
-        SDL_FreeSurface(g_1Surface); g_1Surface = nullptr;
-    if (g_0Surface)
-        SDL_FreeSurface(g_0Surface); g_0Surface = nullptr;
+    for (SDL_Texture*& texture : g_zoomAtlases)
+    {
+        if (texture)
+            SDL_DestroyTexture(texture);
+        texture = nullptr;
+    }
+}
+
+/*
+    The atlas at the current zoom level. Other sizes are scaled from g_atlasTexture once into their own texture,
+    so drawing a frame never scales a tile. Render target contents can be lost, so they are remade after a reset.
+*/
+SDL_Texture* ZoomAtlas()
+{
+    if (TileSize() == IMAGE_WIDTH)
+        return g_atlasTexture;
+    if (g_zoomAtlases[g_zoom])
+        return g_zoomAtlases[g_zoom];
     
-    if (g_window)
-        SDL_DestroyWindow(g_window); g_window = nullptr;
+    SDL_Texture* texture = SDL_CreateTexture(g_renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET,
+                                             int(TileSize()*TILE_COUNT), int(TileSize()));
+    if (!texture)
+    {
+        LOG_FAIL("Failed to create %upx tile atlas: %s", TileSize(), SDL_GetError());
+        return nullptr;
+    }
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_NONE);
     
-    SDL_Quit();
-    VerifySingleInstanceCleanup();
+    // Tile by tile with nearest sampling, so no tile picks up its neighbour's edge pixels.
+    bool ok = SDL_SetRenderTarget(g_renderer, texture) == 0;
+    for (uint32 i = 0; ok && i < TILE_COUNT; i++)
+    {
+        SDL_Rect src = {int(IMAGE_WIDTH*i), 0, IMAGE_WIDTH, IMAGE_HEIGHT};
+        SDL_Rect dst = {int(TileSize()*i), 0, int(TileSize()), int(TileSize())};
+        ok = SDL_RenderCopy(g_renderer, g_atlasTexture, &src, &dst) == 0;
+    }
+    ok = SDL_SetRenderTarget(g_renderer, nullptr) == 0 && ok;
+    if (!ok)
+    {
+        LOG_FAIL("Failed to scale tile atlas to %upx: %s", TileSize(), SDL_GetError());
+        SDL_DestroyTexture(texture);
+        return nullptr;
+    }
     
-    LOG_INFO("Exiting.");
+    g_zoomAtlases[g_zoom] = texture;
+    return texture;
 }
 
-bool DrawCell(uint32 row, uint32 col)
+// Loads every tile image into one atlas texture and fills in the tile lookup table.
+bool LoadAtlas()
 {
-    SDL_Rect rect;
-    rect.w = IMAGE_WIDTH;
-    rect.h = IMAGE_HEIGHT;
-    rect.x = IMAGE_WIDTH*col;
-    rect.y = IMAGE_HEIGHT*row;
-    Cell& c = g_cells[row][col];
-    SDL_Surface* s = nullptr;
-    if (c.isExploded)
+    SDL_Surface* atlas = SDL_CreateRGBSurfaceWithFormat(0, IMAGE_WIDTH*TILE_COUNT, IMAGE_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (!atlas)
     {
-        s = g_explodedSurface;
+        LOG_FAIL("Failed to create atlas: %s", SDL_GetError());
+        return false;
     }
-    else if (c.isRevealed)
+    
+    for (uint32 i = 0; i < TILE_COUNT; i++)
     {
-        switch (c.minesNearby)
+        SDL_Surface* tile = nullptr;
+        if (!LoadImage(TILE_FILES[i], tile))
         {
-            case 0:
-                s = g_0Surface;
-                break;
-            case 1:
-                s = g_1Surface;
-                break;
-            case 2:
-                s = g_2Surface;
-                break;
-            case 3:
-                s = g_3Surface;
-                break;
-            case 4:
-                s = g_4Surface;
-                break;
-            case 5:
-                s = g_5Surface;
-                break;
-            case 6:
-                s = g_6Surface;
-                break;
-            case 7:
-                s = g_7Surface;
-                break;
-            case 8:
-                s = g_8Surface;
-                break;
-            default:
-                LOG_FAIL("Mines nearby exceeded 8 somehow.");
-                return false;
-                break;
+            SDL_FreeSurface(atlas);
+            return false;
+        }
+        
+        SDL_Rect rect = {int(IMAGE_WIDTH*i), 0, IMAGE_WIDTH, IMAGE_HEIGHT};
+        int blit = SDL_BlitSurface(tile, nullptr, atlas, &rect);
+        SDL_FreeSurface(tile);
+        if (blit != 0)
+        {
+            LOG_FAIL("Failed to blit %s into atlas: %s", TILE_FILES[i], SDL_GetError());
+            SDL_FreeSurface(atlas);
+            return false;
         }
     }
-    else if (c.isFlagged)
+    
+    g_atlasTexture = SDL_CreateTextureFromSurface(g_renderer, atlas);
+    SDL_FreeSurface(atlas);
+    if (!g_atlasTexture)
     {
-        s = g_flagSurface;
+        LOG_FAIL("Failed to create atlas texture: %s", SDL_GetError());
+        return false;
     }
-    else if (c.isGuessed)
+    // Tiles are opaque; copying without blending is much cheaper for the software renderer.
+    SDL_SetTextureBlendMode(g_atlasTexture, SDL_BLENDMODE_NONE);
+    // Only the one-off scaling into the zoom atlases samples this texture at another size; keep tile edges crisp there.
+    SDL_SetTextureScaleMode(g_atlasTexture, SDL_ScaleModeNearest);
+    LOG_INFO("Created tile atlas.");
+    
+    // Same precedence DrawCell used to branch on: exploded, revealed, flagged, guessed, pressed, raised.
+    for (uint32 state = 0; state < ARRAY_COUNT(g_tiles); state++)
     {
-        s = g_guessSurface;
+        if (state & TILE_STATE_EXPLODED)
+            g_tiles[state] = TILE_EXPLODED;
+        else if (state & TILE_STATE_REVEALED)
+            g_tiles[state] = TILE_0;
+        else if (state & TILE_STATE_FLAGGED)
+            g_tiles[state] = TILE_FLAG;
+        else if (state & TILE_STATE_GUESSED)
+            g_tiles[state] = TILE_GUESS;
+        else if (state & TILE_STATE_PRESSED)
+            g_tiles[state] = TILE_PRESSED;
+        else
+            g_tiles[state] = TILE_RAISED;
     }
-    else if (c.isPressed)
+    
+    return true;
+}
+
+bool AppInit()
+{
+    // Offscreen runs share no window or save with the game, so several may run at once.
+    if (!g_offscreenFrames && !VerifySingleInstanceInit())
+        return false;
+    
+    // From here on lines are written by the log thread, never by the render thread.
+    ResultBool logStart = LogStart(g_logPath);
+    if (!logStart)
     {
-        s = g_pressedSurface;
+        LOG_FAIL("%s", logStart.error.c_str());
+        return false;
     }
-    else
+    
+    if (g_profile)
     {
-        s = g_raisedSurface;
+        if (!PROFILE_ENABLED)
+            LOG_WARN("Profiling was compiled out of this build; ignoring --profile and --trace.");
+        ProfileStart(!g_tracePath.empty());
     }
     
-    if (SDL_BlitSurface(s, nullptr, g_screenSurface, &rect) != 0)
+    // Offscreen rendering needs neither video nor audio, so it runs on machines without a display.
+    // No joystick or sensor subsystems: while one has a device open SDL polls for events instead of waiting in the OS.
+    if (SDL_Init(g_offscreenFrames ? SDL_INIT_TIMER : (SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_TIMER)) < 0)
     {
-        ss.str("");
-        ss << "Failed to blit surface: " << SDL_GetError();
-        LOG_FAIL(ss.str());
+        LOG_FAIL("Failed to initialize SDL: %s", SDL_GetError());
         return false;
     }
+    LOG_INFO("Initalized SDL.");
     
-    return true;
-}
-
-bool DrawCells()
-{
-    for (uint32 r = 0; r < NUM_ROWS; r++)
+    // The headers may be newer than the library found at run time.
+    SDL_version linked;
+    SDL_GetVersion(&linked);
+    if (SDL_VERSIONNUM(linked.major, linked.minor, linked.patch) < SDL_VERSIONNUM(2, 0, 16))
+        LOG_WARN("SDL %d.%d.%d polls while it waits for events; idle CPU use needs 2.0.16 or newer.", linked.major, linked.minor, linked.patch);
+    
+    if (!g_replayPath.empty())
     {
-        for (uint32 c = 0; c < NUM_COLS; c++)
+        ResultBool replayOpen = g_replay.Open(g_replayPath);
+        if (!replayOpen)
         {
-            if (!DrawCell(r, c))
-                return false;
+            LOG_FAIL("%s", replayOpen.error.c_str());
+            return false;
         }
+        const ReplayHeader& header = g_replay.Header();
+        g_gameMode = {"recorded", header.rows, header.cols, header.mines};
+        g_seed = header.seed;
+        g_seedSet = true;
+        g_replayPending = g_replay.Next(g_replayNext);
+        LOG_INFO("Replaying %s.", g_replayPath.c_str());
     }
     
-    return true;
-}
-
-void MouseToRowCol(int32 x, int32 y, uint32& r, uint32& c)
-{
-    if (x < 0 || x > WINDOW_WIDTH || y < 0 || y > WINDOW_HEIGHT)
+    if (g_loadAtStart && (!g_recordPath.empty() || !g_replayPath.empty()))
+    {
+        LOG_FAIL("--load cannot be combined with --record or --replay; recordings start from a new board.");
+        return false;
+    }
+    if (g_infinite && (g_loadAtStart || !g_recordPath.empty() || !g_replayPath.empty()))
+    {
+        LOG_FAIL("--infinite cannot be combined with --load, --record or --replay.");
+        return false;
+    }
+    if (g_noGuess && (g_infinite || !g_recordPath.empty() || !g_replayPath.empty()))
     {
-        x = 0;
-        y = 0;
+        LOG_FAIL("--no-guess cannot be combined with --infinite, --record or --replay; its boards do not follow the seed.");
+        return false;
+    }
+    if (g_offscreenFrames && (g_infinite || !g_recordPath.empty()))
+    {
+        LOG_FAIL("--offscreen cannot be combined with --infinite or --record.");
+        return false;
     }
     
-    r = std::floor(float(y) / float(IMAGE_HEIGHT));
-    c = std::floor(float(x) / float(IMAGE_WIDTH));
-}
-
-Cell* MouseToCell(int32 x, int32 y)
-{
-    uint32 r;
-    uint32 c;
-    MouseToRowCol(x, y, r, c);
-    return &g_cells[r][c];
-}
-
-int AppLoop()
-{
-    bool quit = false;
-    SDL_Event e;
-    bool lost = false;
-    while (!quit)
+    if (!g_seedSet)
+        g_seed = (uint64(std::random_device()()) << 32) ^ uint64(std::time(nullptr));
+    g_rng.Seed(g_seed);
+    LOG_INFO("Seeded random number generator: %" PRIu64, g_seed);
+    
+    if (g_infinite)
     {
-        while (SDL_PollEvent(&e) != 0)
+        real64 density = real64(g_gameMode.mines) / (real64(g_gameMode.rows) * g_gameMode.cols);
+        ResultBool infiniteInit = g_infiniteBoard.Init(0, density, INFINITE_DEFAULT_RESIDENT, INFINITE_DEFAULT_STORE, INFINITE_SPILL_FILE);
+        if (!infiniteInit)
         {
-            if (e.type == SDL_QUIT || (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE))
-                quit = true;
-            
-            if (e.type == SDL_MOUSEBUTTONDOWN || e.type == SDL_MOUSEBUTTONUP)
-            {
-                if (lost && e.type == SDL_MOUSEBUTTONUP)
+            LOG_FAIL("%s", infiniteInit.error.c_str());
+            return false;
+        }
+        LOG_INFO("Using infinite board with %s density: %.1f%% mines.", g_gameMode.name, g_infiniteBoard.Density() * 100);
+    }
+    else
+    {
+        ResultBool boardInit = (g_loadAtStart ? LoadBoard(g_board, g_savePath) : g_board.Init(g_gameMode.rows, g_gameMode.cols, g_gameMode.mines));
+        if (!boardInit)
+        {
+            LOG_FAIL("%s", boardInit.error.c_str());
+            return false;
+        }
+        if (g_loadAtStart)
+            g_gameMode = {"saved", g_board.Rows(), g_board.Cols(), g_board.Mines()};
+        LOG_INFO("Using %s board: %ux%u with %u mines.", g_gameMode.name, g_board.Rows(), g_board.Cols(), g_board.Mines());
+        g_dirtyFlags.assign(g_board.CellCount(), 0);
+        // The first board is generated while the window and assets load; InitCells swaps it in.
+        if (g_noGuess)
+        {
+            ResultBool generatorStart = g_noGuessGenerator.Start(g_board.Rows(), g_board.Cols(), g_board.Mines(), g_seed, 0);
+            if (!generatorStart)
+            {
+                LOG_FAIL("%s", generatorStart.error.c_str());
+                return false;
+            }
+            LOG_INFO("Generating no-guess boards.");
+        }
+        else if (!g_loadAtStart)
+        {
+            PrepareNextBoard();
+        }
+    }
+    
+    // The window fits the whole board when the screen has room; larger boards are panned and zoomed.
+    // The infinite board takes as much of the screen as a board that does not fit.
+    int64 windowWidth = int64(TileSize())*g_gameMode.cols;
+    int64 windowHeight = int64(TileSize())*g_gameMode.rows;
+    if (g_offscreenFrames)
+    {
+        windowWidth = std::min<int64>(windowWidth, OFFSCREEN_MAX_WIDTH);
+        windowHeight = std::min<int64>(windowHeight, OFFSCREEN_MAX_HEIGHT);
+        if (!CreateOffscreenRenderer(int32(windowWidth), int32(windowHeight)) || !ResizeView())
+            return false;
+    }
+    else
+    {
+        SDL_Rect usable;
+        if (SDL_GetDisplayUsableBounds(0, &usable) == 0)
+        {
+            if (g_infinite)
+            {
+                windowWidth = usable.w;
+                windowHeight = usable.h;
+            }
+            windowWidth = std::min<int64>(windowWidth, int64(usable.w * WINDOW_SCREEN_FRACTION));
+            windowHeight = std::min<int64>(windowHeight, int64(usable.h * WINDOW_SCREEN_FRACTION));
+        }
+        g_window = SDL_CreateWindow("Minesweeper", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, int(windowWidth), int(windowHeight),
+                                    SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
+        if (!g_window)
+        {
+            LOG_FAIL("Failed to create window: %s", SDL_GetError());
+            return false;
+        }
+        LOG_INFO("Created window.");
+        
+        if (!CreateRenderer() || !ResizeView())
+            return false;
+    }
+    
+    ResultBool bundleOpen = g_bundle.Open(g_dataPath + BUNDLE_FILE);
+    if (bundleOpen)
+    {
+        LOG_INFO("Opened asset bundle.");
+    }
+    else
+    {
+        LOG_WARN("%s Loading loose asset files instead.", bundleOpen.error.c_str());
+    }
+    
+    PROFILE_START(loadAssetsTimer, PROFILE_LOAD_ASSETS);
+    if (!LoadAtlas())
+        return false;
+    
+    // Offscreen runs are silent: Play does nothing while the mixer is closed.
+    if (!g_offscreenFrames)
+    {
+        if (!LoadAudio("explode.wav", g_explodeSound, g_explodeSamples))
+            return false;
+        if (!LoadAudio("reveal.wav", g_revealSound, g_revealSamples))
+            return false;
+    }
+    PROFILE_STOP(loadAssetsTimer);
+    
+    if (!g_offscreenFrames)
+    {
+        ResultBool mixerOpen = g_mixer.Open(g_audioFrames);
+        if (!mixerOpen)
+        {
+            LOG_FAIL("%s", mixerOpen.error.c_str());
+            return false;
+        }
+        LOG_INFO("Opened audio device with %u frame buffers.", g_audioFrames);
+    }
+    
+    if (!g_recordPath.empty())
+    {
+        ResultBool recorderOpen = g_recorder.Open(g_recordPath, g_board.Rows(), g_board.Cols(), g_board.Mines(), g_seed);
+        if (!recorderOpen)
+        {
+            LOG_FAIL("%s", recorderOpen.error.c_str());
+            return false;
+        }
+        LOG_INFO("Recording input to %s.", g_recordPath.c_str());
+    }
+    
+    if (g_loadAtStart)
+    {
+        g_solver.Reset(g_board);
+        g_dirtyAll = true;
+        LOG_INFO("Loaded %s.", g_savePath.c_str());
+    }
+    else
+    {
+        InitCells();
+    }
+    g_inputStart = SDL_GetTicks();
+    LOG_INFO("Initialized board.");
+    
+    return true;
+}
+
+void AppCleanup()
+{
+    LOG_INFO("Cleaning up.");
+    
+    if (g_nextBoardReady.valid())
+        g_nextBoardReady.wait();
+    if (g_noGuessGenerator.IsRunning())
+    {
+        g_noGuessGenerator.Stop();
+        g_noGuessGenerator.Report(stdout);
+    }
+    
+    ResultBool recorderClose = g_recorder.Close();
+    if (!recorderClose)
+        LOG_FAIL("%s", recorderClose.error.c_str());
+    
+    // The mixer reads the sounds, which may point into the bundle, so it stops first.
+    g_mixer.Close();
+    g_bundle.Close();
+    
+    DestroyZoomAtlases();
+    if (g_viewTexture)
+        SDL_DestroyTexture(g_viewTexture); g_viewTexture = nullptr;
+    if (g_atlasTexture)
+        SDL_DestroyTexture(g_atlasTexture); g_atlasTexture = nullptr;
+    if (g_renderer)
+        SDL_DestroyRenderer(g_renderer); g_renderer = nullptr;
+    
+    if (g_window)
+        SDL_DestroyWindow(g_window); g_window = nullptr;
+    if (g_offscreenSurface)
+        SDL_FreeSurface(g_offscreenSurface); g_offscreenSurface = nullptr;
+    
+    SDL_Quit();
+    VerifySingleInstanceCleanup();
+    
+    if (ProfileIsRecording())
+    {
+        ProfileReport(stdout);
+        ResultBool traceWrite = {true, ""};
+        if (!g_tracePath.empty())
+            traceWrite = ProfileWriteTrace(g_tracePath);
+        if (!traceWrite)
+            LOG_FAIL("%s", traceWrite.error.c_str());
+    }
+    
+    LOG_INFO("Exiting.");
+    LogStop();
+}
+
+// Picks a cell's tile of either board from its state bits. Counts are only read for revealed cells, so drawing
+// never creates the infinite board's untouched chunks.
+template <typename B>
+uint32 CellTile(B& board, int64 row, int64 col)
+{
+    bool revealed = board.IsRevealed(row, col);
+    uint32 state = (g_pressed && g_pressedRow == row && g_pressedCol == col ? TILE_STATE_PRESSED : 0)
+                 | (board.IsGuessed(row, col) ? TILE_STATE_GUESSED : 0)
+                 | (board.IsFlagged(row, col) ? TILE_STATE_FLAGGED : 0)
+                 | (revealed ? TILE_STATE_REVEALED : 0)
+                 | (board.IsExploded(row, col) ? TILE_STATE_EXPLODED : 0);
+    return g_tiles[state] + (revealed ? board.MinesNearby(row, col) : 0);
+}
+
+// Queues the cell's tile for the next FlushTiles at its place in the view.
+void DrawCell(int64 row, int64 col)
+{
+    uint32 tile = (g_infinite ? CellTile(g_infiniteBoard, row, col) : CellTile(g_board, row, col));
+    
+    int size = int(TileSize());
+    g_tileSrc.push_back({size*int(tile), 0, size, size});
+    g_tileDst.push_back({int(size*col - g_cameraX), int(size*row - g_cameraY), size, size});
+    
+    if (g_heatMap && !g_infinite && g_board.State() == GAME_PLAYING
+        && !g_board.IsRevealed(uint32(row), uint32(col)) && !g_board.IsFlagged(uint32(row), uint32(col)))
+    {
+        real32 p = g_probability.Probability(g_board.Index(uint32(row), uint32(col)));
+        g_heatRects[std::min<uint32>(HEAT_LEVELS - 1, uint32(p * HEAT_LEVELS))].push_back(g_tileDst.back());
+    }
+}
+
+// Submits every queued tile to the view texture in one batch; clear first fills the view around the board.
+bool FlushTiles(bool clear)
+{
+    SDL_Texture* atlas = ZoomAtlas();
+    if (!atlas)
+        return false;
+    
+    bool ok = SDL_SetRenderTarget(g_renderer, g_viewTexture) == 0;
+    if (ok && clear)
+        ok = SDL_SetRenderDrawColor(g_renderer, 0, 0, 0, 255) == 0 && SDL_RenderClear(g_renderer) == 0;
+    for (MemoryIndex i = 0; ok && i < g_tileSrc.size(); i++)
+        ok = SDL_RenderCopy(g_renderer, atlas, &g_tileSrc[i], &g_tileDst[i]) == 0;
+    if (ok)
+        ok = SDL_SetRenderDrawBlendMode(g_renderer, SDL_BLENDMODE_BLEND) == 0;
+    for (uint32 level = 0; ok && level < HEAT_LEVELS; level++)
+    {
+        if (g_heatRects[level].empty())
+            continue;
+        uint8 red = uint8(255 * level / (HEAT_LEVELS - 1));
+        ok = SDL_SetRenderDrawColor(g_renderer, red, uint8(255 - red), 0, HEAT_ALPHA) == 0
+             && SDL_RenderFillRects(g_renderer, g_heatRects[level].data(), int(g_heatRects[level].size())) == 0;
+    }
+    ok = SDL_SetRenderTarget(g_renderer, nullptr) == 0 && ok;
+    g_tileSrc.clear();
+    g_tileDst.clear();
+    for (std::vector<SDL_Rect>& rects : g_heatRects)
+        rects.clear();
+    if (!ok)
+    {
+        LOG_FAIL("Failed to draw tiles: %s", SDL_GetError());
+        return false;
+    }
+    
+    return true;
+}
+
+// Cells at least partly inside the view: rows [rowBegin, rowEnd) and columns [colBegin, colEnd).
+struct VisibleCells
+{
+    int64 rowBegin;
+    int64 rowEnd;
+    int64 colBegin;
+    int64 colEnd;
+};
+
+// Rounds toward negative infinity; the camera of the infinite board goes negative.
+int64 FloorDiv(int64 a, int64 b)
+{
+    return (a >= 0 ? a / b : -((-a + b - 1) / b));
+}
+
+VisibleCells GetVisibleCells()
+{
+    int64 size = TileSize();
+    VisibleCells v;
+    v.rowBegin = FloorDiv(g_cameraY, size);
+    v.rowEnd = FloorDiv(g_cameraY + g_viewHeight - 1, size) + 1;
+    v.colBegin = FloorDiv(g_cameraX, size);
+    v.colEnd = FloorDiv(g_cameraX + g_viewWidth - 1, size) + 1;
+    if (!g_infinite)
+    {
+        v.rowBegin = std::max<int64>(v.rowBegin, 0);
+        v.rowEnd = std::max(v.rowBegin, std::min<int64>(v.rowEnd, g_board.Rows()));
+        v.colBegin = std::max<int64>(v.colBegin, 0);
+        v.colEnd = std::max(v.colBegin, std::min<int64>(v.colEnd, g_board.Cols()));
+    }
+    return v;
+}
+
+// Only the visible cells are drawn, so the cost of a frame follows the window's size rather than the board's.
+void DrawCells(const VisibleCells& v)
+{
+    for (int64 r = v.rowBegin; r < v.rowEnd; r++)
+    {
+        for (int64 c = v.colBegin; c < v.colEnd; c++)
+            DrawCell(r, c);
+    }
+}
+
+// Redraws only the dirty visible cells into the view texture and presents it; an idle frame does nothing.
+bool DrawDirtyCells()
+{
+    if (!g_dirtyAll && g_dirty.empty())
+        return true;
+    
+    PROFILE_START(drawTimer, PROFILE_DRAW);
+    VisibleCells v = GetVisibleCells();
+    if (g_dirtyAll)
+        DrawCells(v);
+    for (uint32 cell : g_dirty)
+    {
+        g_dirtyFlags[cell] = 0;
+        int64 r = cell / g_board.Cols();
+        int64 c = cell % g_board.Cols();
+        // Cells out of view are drawn when a pan or zoom brings them in, which redraws the whole view.
+        if (!g_dirtyAll && r >= v.rowBegin && r < v.rowEnd && c >= v.colBegin && c < v.colEnd)
+            DrawCell(r, c);
+    }
+    g_dirty.clear();
+    bool clear = g_dirtyAll;
+    g_dirtyAll = false;
+    
+    if (!FlushTiles(clear))
+        return false;
+    PROFILE_STOP(drawTimer);
+    
+    PROFILE_SCOPE(PROFILE_PRESENT);
+    if (SDL_RenderCopy(g_renderer, g_viewTexture, nullptr, nullptr) != 0)
+    {
+        LOG_FAIL("Failed to draw board: %s", SDL_GetError());
+        return false;
+    }
+    SDL_RenderPresent(g_renderer);
+    
+    return true;
+}
+
+// Milliseconds since the first board, the clock input recordings use.
+uint64 InputTime()
+{
+    return uint64(SDL_GetTicks() - g_inputStart);
+}
+
+// Records and applies one input, live or replayed, then redraws what it changed and plays its sound.
+MoveResult HandleInput(InputAction action, uint32 cell, uint64 time)
+{
+    InputEvent input = {time, action, cell};
+    if (g_recorder.IsOpen())
+        g_recorder.Record(input);
+    
+    if (action == INPUT_NEW_GAME)
+    {
+        InitCells();
+        return MOVE_NONE;
+    }
+    
+    InputResult result;
+    {
+        PROFILE_SCOPE(PROFILE_REVEAL);
+        result = ApplyInput(g_board, g_solver, g_rng, input);
+    }
+    if (result.changed)
+        MarkChanged();
+    MarkDirty(result.flagged);
+    // A reveal moves the probability of every covered cell, and the heat map goes when the game ends.
+    if (result.changed)
+    {
+        g_heatMapStale = true;
+        if (g_heatMap)
+            g_dirtyAll = true;
+    }
+    if (action == INPUT_HINT && !result.changed && result.flagged == BOARD_NO_CELL)
+        LOG_INFO("No provable move.");
+    
+    if (result.move == MOVE_EXPLODED)
+    {
+        LOG_INFO("Lost.");
+    }
+    else if (result.move == MOVE_REVEALED)
+    {
+        if (g_board.State() == GAME_WON)
+            LOG_INFO("Won.");
+        PlayRevealAudio();
+    }
+    return result.move;
+}
+
+// HandleInput for the infinite board, which has no solver, recordings or winning.
+MoveResult HandleInfiniteInput(InputAction action, int64 r, int64 c)
+{
+    MoveResult result = MOVE_NONE;
+    {
+        PROFILE_SCOPE(PROFILE_REVEAL);
+        if (action == INPUT_REVEAL)
+            result = g_infiniteBoard.Reveal(r, c);
+        else if (action == INPUT_CHORD)
+            result = g_infiniteBoard.Chord(r, c);
+        else if (action == INPUT_MARK)
+            g_infiniteBoard.CycleMark(r, c);
+    }
+    if (!g_infiniteBoard.Changed().empty())
+        g_dirtyAll = true;
+    
+    if (result == MOVE_EXPLODED)
+        LOG_INFO("Lost after revealing %" PRIu64 " cells.", g_infiniteBoard.RevealedCount());
+    else if (result == MOVE_REVEALED)
+        PlayRevealAudio();
+    return result;
+}
+
+// A click on a cell of whichever board is being played.
+MoveResult HandleCellInput(InputAction action, int64 r, int64 c)
+{
+    if (g_infinite)
+        return HandleInfiniteInput(action, r, c);
+    return HandleInput(action, g_board.Index(uint32(r), uint32(c)), InputTime());
+}
+
+void SaveGame()
+{
+    if (g_infinite)
+    {
+        LOG_WARN("The infinite board cannot be saved.");
+        return;
+    }
+    
+    ResultBool saved = SaveBoard(g_board, g_savePath);
+    if (!saved)
+    {
+        LOG_FAIL("%s", saved.error.c_str());
+        return;
+    }
+    LOG_INFO("Saved %s.", g_savePath.c_str());
+}
+
+// The view keeps its size; a save of another board size just pans and zooms like any other board.
+void LoadGame()
+{
+    if (g_infinite)
+    {
+        LOG_WARN("Saves cannot be loaded into the infinite board; restart without --infinite to load one.");
+        return;
+    }
+    if (g_recorder.IsOpen() || g_replay.IsOpen())
+    {
+        LOG_WARN("Loading is disabled while recording or replaying; the recording would no longer match the board.");
+        return;
+    }
+    
+    uint32 rows = g_board.Rows();
+    uint32 cols = g_board.Cols();
+    uint32 mines = g_board.Mines();
+    Board loaded;
+    ResultBool load = LoadBoard(loaded, g_savePath);
+    if (!load)
+    {
+        LOG_FAIL("%s", load.error.c_str());
+        return;
+    }
+    
+    g_board = std::move(loaded);
+    g_solver.Reset(g_board);
+    g_pressed = false;
+    g_dirty.clear();
+    g_dirtyFlags.assign(g_board.CellCount(), 0);
+    g_heatMapStale = true;
+    ClampCamera();
+    // New games keep to the loaded size, so the pool starts over at it.
+    if (g_noGuess && (g_board.Rows() != rows || g_board.Cols() != cols || g_board.Mines() != mines))
+    {
+        g_noGuessGenerator.Report(stdout);
+        ResultBool generatorStart = g_noGuessGenerator.Start(g_board.Rows(), g_board.Cols(), g_board.Mines(), g_seed, 0);
+        if (!generatorStart)
+            LOG_FAIL("%s", generatorStart.error.c_str());
+    }
+    LOG_INFO("Loaded %s.", g_savePath.c_str());
+}
+
+void ToggleHeatMap()
+{
+    if (g_infinite)
+    {
+        LOG_WARN("The heat map needs the mine total, which the infinite board does not have.");
+        return;
+    }
+    g_heatMap = !g_heatMap;
+    g_dirtyAll = true;
+}
+
+// Works out the probabilities the heat map shows, once per position, right before the frame that draws them.
+void UpdateHeatMap()
+{
+    if (!g_heatMap || !g_heatMapStale)
+        return;
+    
+    PROFILE_SCOPE(PROFILE_PROBABILITY);
+    g_probability.Compute(g_board);
+    g_heatMapStale = false;
+}
+
+// Finds the cell under a point in the view; false when the point is off the board.
+bool MouseToRowCol(int32 x, int32 y, int64& r, int64& c)
+{
+    int64 size = TileSize();
+    r = FloorDiv(g_cameraY + y, size);
+    c = FloorDiv(g_cameraX + x, size);
+    if (g_infinite)
+        return InfiniteBoard::InBounds(r, c);
+    return r >= 0 && c >= 0 && r < g_board.Rows() && c < g_board.Cols();
+}
+
+// Ticks of the performance counter between frames: the --fps limit, or else the display's refresh rate.
+uint64 GetFrameTicks()
+{
+    uint32 fps = g_fpsLimit;
+    if (fps == 0)
+    {
+        SDL_DisplayMode mode;
+        int display = SDL_GetWindowDisplayIndex(g_window);
+        if (display >= 0 && SDL_GetCurrentDisplayMode(display, &mode) == 0 && mode.refresh_rate > 0)
+            fps = uint32(mode.refresh_rate);
+        else
+            fps = DEFAULT_FPS;
+    }
+    
+    LOG_INFO("Drawing at most %u frames per second.", fps);
+    return SDL_GetPerformanceFrequency() / fps;
+}
+
+/*
+    Sleeps in SDL_WaitEventTimeout until there is input. Once something is dirty it only waits until the
+    next frame is due, so redraws are capped to one per frame while the first change after an idle period
+    is drawn at once. With nothing to draw the wait has no timeout, and SDL 2.0.16 and later block in the
+    OS (MsgWaitForMultipleObjects, or poll on the X11 connection) until an event arrives.
+*/
+int AppLoop()
+{
+    bool quit = false;
+    SDL_Event e;
+    uint64 frameTicks = GetFrameTicks();
+    uint64 lastFrame = SDL_GetPerformanceCounter() - frameTicks;
+    while (!quit)
+    {
+        int timeout = -1;
+        if (g_dirtyAll || !g_dirty.empty())
+        {
+            uint64 elapsed = SDL_GetPerformanceCounter() - lastFrame;
+            // Round up so the wait never returns just short of the frame and spins.
+            timeout = (elapsed >= frameTicks ? 0 : int((frameTicks - elapsed) * 1000 / SDL_GetPerformanceFrequency()) + 1);
+        }
+        if (g_replayPending)
+        {
+            uint64 now = InputTime();
+            int untilInput = int(g_replayNext.time <= now ? 0 : std::min<uint64>(g_replayNext.time - now, INT32_MAX));
+            timeout = (timeout < 0 ? untilInput : std::min(timeout, untilInput));
+        }
+        
+        PROFILE_START(waitTimer, PROFILE_WAIT);
+        bool more = SDL_WaitEventTimeout(&e, timeout) != 0;
+        PROFILE_STOP(waitTimer);
+        
+        PROFILE_START(eventsTimer, PROFILE_EVENTS);
+        for (; more; more = SDL_PollEvent(&e) != 0)
+        {
+            if (e.type == SDL_QUIT || (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE))
+                quit = true;
+            
+            // The window or the render targets may have lost their contents.
+            if ((e.type == SDL_WINDOWEVENT && (e.window.event == SDL_WINDOWEVENT_EXPOSED || e.window.event == SDL_WINDOWEVENT_SIZE_CHANGED))
+                || e.type == SDL_RENDER_TARGETS_RESET || e.type == SDL_RENDER_DEVICE_RESET)
+            {
+                g_dirtyAll = true;
+            }
+            if (e.type == SDL_RENDER_TARGETS_RESET || e.type == SDL_RENDER_DEVICE_RESET)
+                DestroyZoomAtlases();
+            if (e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_SIZE_CHANGED && !ResizeView())
+                return -1;
+            
+            // Panning and zooming only move the view, so they work while replaying too.
+            if (e.type == SDL_MOUSEWHEEL)
+            {
+                int x = 0;
+                int y = 0;
+                SDL_GetMouseState(&x, &y);
+                int32 wheel = (e.wheel.direction == SDL_MOUSEWHEEL_FLIPPED ? -e.wheel.y : e.wheel.y);
+                if (wheel != 0)
+                    ZoomCamera(wheel, x, y);
+                if (e.wheel.x != 0)
+                    PanCamera(int64(e.wheel.x) * TileSize(), 0);
+            }
+            else if (e.type == SDL_KEYDOWN)
+            {
+                int64 panX = int64(g_viewWidth * PAN_FRACTION);
+                int64 panY = int64(g_viewHeight * PAN_FRACTION);
+                SDL_Keycode key = e.key.keysym.sym;
+                if (key == SDLK_LEFT)
+                    PanCamera(-panX, 0);
+                else if (key == SDLK_RIGHT)
+                    PanCamera(panX, 0);
+                else if (key == SDLK_UP)
+                    PanCamera(0, -panY);
+                else if (key == SDLK_DOWN)
+                    PanCamera(0, panY);
+                else if (key == SDLK_EQUALS || key == SDLK_KP_PLUS)
+                    ZoomCamera(1, g_viewWidth / 2, g_viewHeight / 2);
+                else if (key == SDLK_MINUS || key == SDLK_KP_MINUS)
+                    ZoomCamera(-1, g_viewWidth / 2, g_viewHeight / 2);
+            }
+            
+            if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F5)
+                SaveGame();
+            else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F9)
+                LoadGame();
+            else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_p)
+                ToggleHeatMap();
+            
+            // A replay owns the board; live clicks and keys would make it diverge from the recording.
+            if (g_replay.IsOpen())
+                continue;
+            
+            if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_h && !g_infinite && g_board.State() == GAME_PLAYING)
+            {
+                // Hint: play one move the solver has proven, safe cells first.
+                HandleInput(INPUT_HINT, BOARD_NO_CELL, InputTime());
+            }
+            
+            if (e.type == SDL_MOUSEBUTTONDOWN || e.type == SDL_MOUSEBUTTONUP)
+            {
+                if (CurrentState() != GAME_PLAYING && e.type == SDL_MOUSEBUTTONUP)
                 {
-                    InitCells();
-                    lost = false;
+                    HandleInput(INPUT_NEW_GAME, BOARD_NO_CELL, InputTime());
                     while (SDL_PollEvent(&e) != 0) {}
                     break;
                 }
                 
-                uint32 r;
-                uint32 c;
-                MouseToRowCol(e.button.x, e.button.y, r, c);
-                Cell* cell = MouseToCell(e.button.x, e.button.y);
+                int64 r;
+                int64 c;
+                if (!MouseToRowCol(e.button.x, e.button.y, r, c))
+                {
+                    // Off the board: a press held onto the board's edge and released there just lets go.
+                    if (e.type == SDL_MOUSEBUTTONUP)
+                        SetPressedCell(false, 0, 0);
+                    continue;
+                }
                 
                 if (e.type == SDL_MOUSEBUTTONUP)
                 {
+                    SetPressedCell(false, 0, 0);
+                    
+                    MoveResult result = MOVE_NONE;
                     if (e.button.button == SDL_BUTTON_MIDDLE)
-                    {
-                        // Reveal
-                        if (cell->isRevealed)
-                        {
-                            bool mineNearby = false;
-                            Cell* l = (c > 0 ? &g_cells[r][c-1] : nullptr);
-                            Cell* tl = ((r > 0 && c > 0) ? &g_cells[r-1][c-1] : nullptr);
-                            Cell* t = (r > 0 ? &g_cells[r-1][c] : nullptr);
-                            Cell* tr = ((r > 0 && c < (NUM_COLS-1)) ? &g_cells[r-1][c+1] : nullptr);
-                            Cell* right = ((c < (NUM_COLS-1)) ? &g_cells[r][c+1] : nullptr);
-                            Cell* br = ((r < (NUM_ROWS-1) && c < (NUM_COLS-1)) ? &g_cells[r+1][c+1] : nullptr);
-                            Cell* b = ((r < (NUM_ROWS-1)) ? &g_cells[r+1][c] : nullptr);
-                            Cell* bl = ((r < (NUM_ROWS-1)) ? &g_cells[r+1][c-1] : nullptr);
-                            
-                            if (l && (l->isMine || l->isFlagged))
-                                mineNearby = true;
-                            if (tl && (tl->isMine || tl->isFlagged))
-                                mineNearby = true;
-                            if (t && (t->isMine || t->isFlagged))
-                                mineNearby = true;
-                            if (tr && (tr->isMine || tr->isFlagged))
-                                mineNearby = true;
-                            if (right && (right->isMine || right->isFlagged))
-                                mineNearby = true;
-                            if (br && (br->isMine || br->isFlagged))
-                                mineNearby = true;
-                            if (b && (b->isMine || b->isFlagged))
-                                mineNearby = true;
-                            if (bl && (bl->isMine || bl->isFlagged))
-                                mineNearby = true;
-                            
-                            if (!mineNearby)
-                            {
-                                if (l) l->isRevealed = true;
-                                if (tl) tl->isRevealed = true;
-                                if (t) t->isRevealed = true;
-                                if (tr) tr->isRevealed = true;
-                                if (right) right->isRevealed = true;
-                                if (br) br->isRevealed = true;
-                                if (b) b->isRevealed = true;
-                                if (bl) bl->isRevealed = true;
-                            }
-                        }
-                    }
+                        result = HandleCellInput(INPUT_CHORD, r, c);
                     else if (e.button.button == SDL_BUTTON_LEFT)
+                        result = HandleCellInput(INPUT_REVEAL, r, c);
+                    
+                    if (result == MOVE_EXPLODED)
                     {
-                        // Activate cell
-                        if (!cell->isFlagged)
-                        {
-                            if (cell->isMine)
-                            {
-                                // Lose
-                                cell->isExploded = true;
-                                cell->isPressed = false;
-                                lost = true;
-                                while (SDL_PollEvent(&e) != 0) {}
-                                break;
-                            }
-                            else if (!cell->isRevealed)
-                            {
-                                // Not a mine!
-                                cell->isRevealed = true;
-                                cell->isGuessed = false;
-                                cell->isPressed = false;
-                                if (!PlayRevealAudio())
-                                {
-                                    quit = true;
-                                    break;
-                                }
-                            }
-                        }
+                        // Lose
+                        while (SDL_PollEvent(&e) != 0) {}
+                        break;
                     }
                 }
+                else if (e.type == SDL_MOUSEBUTTONDOWN && e.button.button == SDL_BUTTON_LEFT)
+                {
+                    bool covered = (g_infinite ? !g_infiniteBoard.IsRevealed(r, c) && !g_infiniteBoard.IsFlagged(r, c)
+                                               : !g_board.IsRevealed(uint32(r), uint32(c)) && !g_board.IsFlagged(uint32(r), uint32(c)));
+                    if (covered)
+                        SetPressedCell(true, r, c);
+                }
                 else if (e.type == SDL_MOUSEBUTTONDOWN && e.button.button == SDL_BUTTON_RIGHT)
                 {
                     // Flag or guess
-                    if (!cell->isRevealed)
-                    {
-                        if (cell->isFlagged)
-                        {
-                            cell->isFlagged = false; cell->isGuessed = true;
-                        }
-                        else if (cell->isGuessed)
-                        {
-                            cell->isFlagged = false; cell->isGuessed = false;
-                        }
-                        else
-                        {
-                            cell->isFlagged = true; cell->isGuessed = false;
-                        }
-                    }
+                    HandleCellInput(INPUT_MARK, r, c);
                 }
             }
         }
+        PROFILE_STOP(eventsTimer);
         
-        if (!DrawCells())
-            return -1;
+        // Recorded inputs play at the time they were recorded, through the same HandleInput as clicks.
+        while (g_replayPending && g_replayNext.time <= InputTime())
+        {
+            HandleInput(g_replayNext.action, g_replayNext.cell, g_replayNext.time);
+            g_replayPending = g_replay.Next(g_replayNext);
+            if (g_replay.Failed())
+                LOG_FAIL("%s is corrupt; stopped replaying.", g_replayPath.c_str());
+            else if (!g_replayPending)
+                LOG_INFO("Replay finished.");
+        }
         
-        if (SDL_UpdateWindowSurface(g_window) != 0)
+        uint64 now = SDL_GetPerformanceCounter();
+        if ((g_dirtyAll || !g_dirty.empty()) && now - lastFrame >= frameTicks)
         {
-            ss.str("");
-            ss << "Failed to update window surface: " << SDL_GetError();
-            LOG_FAIL(ss.str());
+            UpdateHeatMap();
+            if (!DrawDirtyCells())
+                return -1;
+            lastFrame = now;
+            // Everything on screen was just drawn, so only chunks out of view are evicted.
+            if (g_infinite)
+                g_infiniteBoard.Trim();
+        }
+    }
+    
+    return 0;
+}
+
+// FNV-1a of the offscreen view's pixels, so two runs can check they drew the same frame without comparing files.
+uint64 OffscreenPixelHash()
+{
+    uint64 hash = 0xCBF29CE484222325ULL;
+    const uint8* bytes = reinterpret_cast<const uint8*>(g_offscreenPixels.data());
+    for (MemoryIndex i = 0; i < g_offscreenPixels.size() * sizeof(uint32); i++)
+        hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+    return hash;
+}
+
+// Saves the offscreen view as <prefix><frame>.bmp and logs its hash.
+bool SaveSnapshot(uint32 frame)
+{
+    char number[16];
+    std::snprintf(number, sizeof(number), "%06u", frame);
+    std::string path = g_snapshotPrefix + number + ".bmp";
+    if (SDL_SaveBMP(g_offscreenSurface, path.c_str()) != 0)
+    {
+        LOG_FAIL("Failed to save snapshot %s: %s", path.c_str(), SDL_GetError());
+        return false;
+    }
+    LOG_INFO("Saved %s: pixel hash %016" PRIx64 ".", path.c_str(), OffscreenPixelHash());
+    return true;
+}
+
+// One input of the offscreen script: see OffscreenLoop.
+void ScriptInput(Random& script)
+{
+    if (g_board.State() != GAME_PLAYING)
+    {
+        HandleInput(INPUT_NEW_GAME, BOARD_NO_CELL, InputTime());
+        return;
+    }
+    
+    uint32 cell;
+    if (g_solver.NextSafe(g_board, cell))
+    {
+        HandleInput(INPUT_REVEAL, cell, InputTime());
+    }
+    else if (g_solver.NextMine(g_board, cell))
+    {
+        HandleInput(INPUT_MARK, cell, InputTime());
+    }
+    else
+    {
+        // Flags only go on proven mines, so while the game goes on there is a covered cell without one.
+        do
+        {
+            cell = script.Below(g_board.CellCount());
+        }
+        while (g_board.IsRevealed(cell / g_board.Cols(), cell % g_board.Cols()) || g_board.IsFlagged(cell / g_board.Cols(), cell % g_board.Cols()));
+        HandleInput(INPUT_REVEAL, cell, InputTime());
+    }
+}
+
+/*
+    --offscreen: draws g_offscreenFrames frames as fast as it can, applying one input through HandleInput before each.
+    With --replay the inputs are the recording's, in order and without waiting for their times. Otherwise a script
+    plays: the solver's next safe cell, else its next mine to flag, else a random covered cell, and a new game once
+    one ends. The script has its own generator seeded from the seed, so the same arguments draw the same frames.
+    Frames redraw what the input changed, as in the window, or the whole view with --full-frames.
+*/
+int OffscreenLoop()
+{
+    Random script(~g_seed);
+    std::vector<uint64> frameTicks;
+    frameTicks.reserve(g_frameTimesPath.empty() ? 0 : g_offscreenFrames);
+    uint64 drawTicks = 0;
+    uint64 start = SDL_GetPerformanceCounter();
+    uint64 snapshotTicks = 0;
+    uint32 frames = 0;
+    for (; frames < g_offscreenFrames; frames++)
+    {
+        if (g_replay.IsOpen())
+        {
+            if (!g_replayPending)
+            {
+                LOG_INFO("Replay finished after %u frames.", frames);
+                break;
+            }
+            HandleInput(g_replayNext.action, g_replayNext.cell, g_replayNext.time);
+            g_replayPending = g_replay.Next(g_replayNext);
+            if (g_replay.Failed())
+            {
+                LOG_FAIL("%s is corrupt; stopped replaying.", g_replayPath.c_str());
+                return -1;
+            }
+        }
+        else
+        {
+            ScriptInput(script);
+        }
+        
+        uint64 drawStart = SDL_GetPerformanceCounter();
+        if (g_offscreenFull)
+            g_dirtyAll = true;
+        UpdateHeatMap();
+        if (!DrawDirtyCells())
             return -1;
+        uint64 frameEnd = SDL_GetPerformanceCounter();
+        drawTicks += frameEnd - drawStart;
+        if (!g_frameTimesPath.empty())
+            frameTicks.push_back(frameEnd - drawStart);
+        
+        // Snapshots are written outside the timed frames.
+        bool last = (frames + 1 == g_offscreenFrames);
+        if (!g_snapshotPrefix.empty() && (g_snapshotEvery ? (frames + 1) % g_snapshotEvery == 0 : last))
+        {
+            uint64 snapshotStart = SDL_GetPerformanceCounter();
+            if (!SaveSnapshot(frames))
+                return -1;
+            snapshotTicks += SDL_GetPerformanceCounter() - snapshotStart;
         }
-        SDL_Delay(1);
     }
     
+    real64 frequency = real64(SDL_GetPerformanceFrequency());
+    real64 seconds = (SDL_GetPerformanceCounter() - start - snapshotTicks) / frequency;
+    std::printf("Rendered %u %s frames of a %dx%d view in %.3fs: %.1f frames/s, %.1fus drawing per frame.\n", frames,
+                (g_offscreenFull ? "full" : "dirty"), g_viewWidth, g_viewHeight, seconds, (seconds > 0 ? frames / seconds : 0),
+                (frames ? drawTicks / frequency * 1e6 / frames : 0));
+    std::printf("Last frame pixel hash: %016" PRIx64 ".\n", OffscreenPixelHash());
+    
+    // One frame per line in nanoseconds, for minesweeper_bench's render case.
+    if (!g_frameTimesPath.empty())
+    {
+        std::ofstream out(g_frameTimesPath, std::ios::trunc);
+        for (uint64 ticks : frameTicks)
+            out << uint64(ticks / frequency * 1e9) << '\n';
+        if (!out)
+        {
+            LOG_FAIL("Failed to write %s.", g_frameTimesPath.c_str());
+            return -1;
+        }
+    }
     return 0;
 }
 
+// Usage: minesweeper GAME_ARGS_USAGE [--fps <n>] [--audio-buffer <frames>] [--log <file>] [--profile] [--trace <file>]
+//                     [--record <file> | --replay <file>] [--save <file>] [--load <file>] [--infinite] [--no-guess]
+//                     [--heat-map] [--offscreen <frames> [--full-frames] [--snapshot <prefix> [--snapshot-every <n>]]
+//                     [--frame-times <file>]] [--data <dir>]
+// --record saves every input with the seed; --replay plays such a recording back at its recorded speed.
+// F5 saves the game to --save <file> (default SAVE_DEFAULT_FILE) and F9 loads it; --load <file> starts from a save.
+// --profile prints each hot path's latency percentiles at exit; --trace <file> also writes a Chrome trace of every timed scope.
+// --infinite plays an unbounded board with the game mode's share of mines; it cannot be saved or recorded.
+// --no-guess deals only boards the solver finishes from their opening, generated on worker threads.
+// P toggles a heat map of every covered cell's chance of being a mine; --heat-map starts with it on.
+// --offscreen <frames> renders that many frames of a scripted game (or of --replay) without a window and logs the frame
+// rate; --full-frames redraws the whole view every frame. --snapshot <prefix> saves the last frame, or every
+// --snapshot-every <n>th, as <prefix><frame>.bmp with its pixel hash. --frame-times <file> writes every frame's drawing
+// time in nanoseconds, one per line.
+// --data <dir> loads the assets from dir instead of the built-in data path.
+// --audio-buffer must be a power of two from 64 to 8192.
+bool ParseArgs(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        ArgResult result = ParseGameArg(argc, argv, i, g_gameMode, g_seed, g_seedSet);
+        if (result == ARG_INVALID)
+            return false;
+        if (result == ARG_OK)
+            continue;
+        
+        if (std::string(argv[i]) == "--fps" && i + 1 < argc && ParseUint32(argv[i+1], g_fpsLimit))
+        {
+            i++;
+        }
+        else if (std::string(argv[i]) == "--audio-buffer" && i + 1 < argc && ParseUint32(argv[i+1], g_audioFrames)
+                 && g_audioFrames >= 64 && g_audioFrames <= 8192 && (g_audioFrames & (g_audioFrames - 1)) == 0)
+        {
+            i++;
+        }
+        else if (std::string(argv[i]) == "--log" && i + 1 < argc)
+        {
+            g_logPath = argv[++i];
+        }
+        else if (std::string(argv[i]) == "--record" && i + 1 < argc)
+        {
+            g_recordPath = argv[++i];
+        }
+        else if (std::string(argv[i]) == "--replay" && i + 1 < argc)
+        {
+            g_replayPath = argv[++i];
+        }
+        else if (std::string(argv[i]) == "--save" && i + 1 < argc)
+        {
+            g_savePath = argv[++i];
+        }
+        else if (std::string(argv[i]) == "--load" && i + 1 < argc)
+        {
+            g_savePath = argv[++i];
+            g_loadAtStart = true;
+        }
+        else if (std::string(argv[i]) == "--infinite")
+        {
+            g_infinite = true;
+        }
+        else if (std::string(argv[i]) == "--no-guess")
+        {
+            g_noGuess = true;
+        }
+        else if (std::string(argv[i]) == "--profile")
+        {
+            g_profile = true;
+        }
+        else if (std::string(argv[i]) == "--trace" && i + 1 < argc)
+        {
+            g_profile = true;
+            g_tracePath = argv[++i];
+        }
+        else if (std::string(argv[i]) == "--heat-map")
+        {
+            g_heatMap = true;
+        }
+        else if (std::string(argv[i]) == "--offscreen" && i + 1 < argc && ParseUint32(argv[i+1], g_offscreenFrames) && g_offscreenFrames > 0)
+        {
+            i++;
+        }
+        else if (std::string(argv[i]) == "--full-frames")
+        {
+            g_offscreenFull = true;
+        }
+        else if (std::string(argv[i]) == "--snapshot" && i + 1 < argc)
+        {
+            g_snapshotPrefix = argv[++i];
+        }
+        else if (std::string(argv[i]) == "--snapshot-every" && i + 1 < argc && ParseUint32(argv[i+1], g_snapshotEvery))
+        {
+            i++;
+        }
+        else if (std::string(argv[i]) == "--frame-times" && i + 1 < argc)
+        {
+            g_frameTimesPath = argv[++i];
+        }
+        else if (std::string(argv[i]) == "--data" && i + 1 < argc)
+        {
+            g_dataPath = argv[++i];
+            if (g_dataPath.back() != '/' && g_dataPath.back() != '\\')
+                g_dataPath += '/';
+        }
+        else
+        {
+            LOG_FAIL("Unknown argument: %s", argv[i]);
+            // Printed, not logged: log lines are cut at LOG_LINE_SIZE.
+            std::printf("Usage: minesweeper " GAME_ARGS_USAGE " [--fps <n>] [--audio-buffer <frames>] [--log <file>] [--profile] [--trace <file>]"
+                        " [--record <file> | --replay <file>] [--save <file>] [--load <file>] [--infinite] [--no-guess] [--heat-map]"
+                        " [--offscreen <frames> [--full-frames] [--snapshot <prefix> [--snapshot-every <n>]] [--frame-times <file>]] [--data <dir>]\n");
+            return false;
+        }
+    }
+    
+    return true;
+}
+
 // WARNING: SDL 2 requires this function signature; changing it will give "undefined reference to SDL_main" linker errors.
 int main(int argc, char* argv[])
 {
@@ -761,8 +1733,8 @@ int main(int argc, char* argv[])
     
     try
     {
-        if (AppInit())
-            ret = AppLoop();
+        if (ParseArgs(argc, argv) && AppInit())
+            ret = (g_offscreenFrames ? OffscreenLoop() : AppLoop());
     }
     catch (const std::exception& e)
     {
@@ -0,0 +1,138 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+#include "mixer.h"
+
+#include <algorithm> // min, max
+
+
+ResultBool ConvertWav(const SDL_AudioSpec& spec, const uint8* buf, uint32 len, std::vector<float>& samples)
+{
+    ResultBool ret = {false, ""};
+    
+    SDL_AudioCVT cvt;
+    if (SDL_BuildAudioCVT(&cvt, spec.format, spec.channels, spec.freq, AUDIO_F32SYS, BUNDLE_AUDIO_CHANNELS, BUNDLE_AUDIO_FREQUENCY) < 0)
+    {
+        ret.error = std::string("Failed to convert audio: ") + SDL_GetError();
+        return ret;
+    }
+    
+    // SDL converts in place and may need up to len * len_mult bytes.
+    std::vector<uint8> bytes(MemorySize(len) * std::max(cvt.len_mult, 1));
+    std::memcpy(bytes.data(), buf, len);
+    cvt.buf = bytes.data();
+    cvt.len = int(len);
+    if (cvt.needed && SDL_ConvertAudio(&cvt) != 0)
+    {
+        ret.error = std::string("Failed to convert audio: ") + SDL_GetError();
+        return ret;
+    }
+    
+    MemorySize converted = (cvt.needed ? MemorySize(cvt.len_cvt) : len);
+    uint32 frameSize = sizeof(float) * BUNDLE_AUDIO_CHANNELS;
+    samples.resize(converted / frameSize * BUNDLE_AUDIO_CHANNELS);
+    std::memcpy(samples.data(), bytes.data(), samples.size() * sizeof(float));
+    
+    ret.result = true;
+    return ret;
+}
+
+ResultBool Mixer::Open(uint32 frames)
+{
+    ResultBool ret = {false, ""};
+    
+    SDL_AudioSpec desired;
+    SDL_zero(desired);
+    desired.freq = BUNDLE_AUDIO_FREQUENCY;
+    desired.format = AUDIO_F32SYS;
+    desired.channels = BUNDLE_AUDIO_CHANNELS;
+    desired.samples = Uint16(frames);
+    desired.callback = Callback;
+    desired.userdata = this;
+    // No changes allowed: the callback always gets the format the samples were converted to.
+    m_device = SDL_OpenAudioDevice(nullptr, 0, &desired, nullptr, 0);
+    if (m_device == 0)
+    {
+        ret.error = std::string("Failed to open audio device: ") + SDL_GetError();
+        return ret;
+    }
+    SDL_PauseAudioDevice(m_device, 0);
+    
+    ret.result = true;
+    return ret;
+}
+
+void Mixer::Close()
+{
+    if (m_device)
+        SDL_CloseAudioDevice(m_device);
+    m_device = 0;
+    for (Voice& v : m_voices)
+        v = Voice();
+}
+
+void Mixer::Play(const Sound& sound)
+{
+    if (!m_device || sound.frames == 0)
+        return;
+    
+    // Prefer a free voice; else the oldest voice of this sound once it has MIXER_MAX_REPEATS; else the oldest voice.
+    Voice* freeVoice = nullptr;
+    Voice* oldestSame = nullptr;
+    Voice* oldest = &m_voices[0];
+    uint32 same = 0;
+    SDL_LockAudioDevice(m_device);
+    for (Voice& v : m_voices)
+    {
+        if (!v.sound)
+        {
+            freeVoice = (freeVoice ? freeVoice : &v);
+            continue;
+        }
+        if (v.sound == &sound)
+        {
+            same++;
+            if (!oldestSame || v.started < oldestSame->started)
+                oldestSame = &v;
+        }
+        if (!oldest->sound || v.started < oldest->started)
+            oldest = &v;
+    }
+    
+    Voice* voice = (same >= MIXER_MAX_REPEATS ? oldestSame : (freeVoice ? freeVoice : oldest));
+    voice->sound = &sound;
+    voice->position = 0;
+    voice->started = m_plays++;
+    SDL_UnlockAudioDevice(m_device);
+}
+
+void SDLCALL Mixer::Callback(void* userdata, Uint8* stream, int len)
+{
+    static_cast<Mixer*>(userdata)->Mix(reinterpret_cast<float*>(stream), uint32(len) / (sizeof(float) * BUNDLE_AUDIO_CHANNELS));
+}
+
+// Runs on the audio thread with the device locked.
+void Mixer::Mix(float* out, uint32 frames)
+{
+    std::memset(out, 0, MemorySize(frames) * BUNDLE_AUDIO_CHANNELS * sizeof(float));
+    for (Voice& v : m_voices)
+    {
+        if (!v.sound)
+            continue;
+        
+        uint32 count = std::min(frames, v.sound->frames - v.position);
+        const float* in = v.sound->samples + MemorySize(v.position) * BUNDLE_AUDIO_CHANNELS;
+        for (uint32 i = 0; i < count * BUNDLE_AUDIO_CHANNELS; i++)
+            out[i] += in[i];
+        v.position += count;
+        if (v.position == v.sound->frames)
+            v = Voice();
+    }
+    
+    for (uint32 i = 0; i < frames * BUNDLE_AUDIO_CHANNELS; i++)
+        out[i] = std::min(1.0f, std::max(-1.0f, out[i]));
+}
@@ -0,0 +1,63 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+#ifndef MIXER_H
+#define MIXER_H
+
+#include "common.h"
+#include "bundle.h"
+
+#include <SDL.h>
+#include <vector>
+
+
+#define MIXER_VOICES 8
+// Most voices of one sound playing at once; playing it again restarts the oldest of them.
+#define MIXER_MAX_REPEATS 2
+// Frames per device buffer; latency is about two buffers, 512 is ~11 ms at 48 kHz.
+#define MIXER_DEFAULT_FRAMES 512
+
+// Interleaved float samples in the mixer's format (BUNDLE_AUDIO_CHANNELS at BUNDLE_AUDIO_FREQUENCY).
+struct Sound
+{
+    const float* samples = nullptr;
+    uint32 frames = 0;
+};
+
+// Converts a WAV loaded by SDL into the mixer's format.
+ResultBool ConvertWav(const SDL_AudioSpec& spec, const uint8* buf, uint32 len, std::vector<float>& samples);
+
+/*
+    Mixes a fixed pool of voices in the audio callback, so nothing ever queues up behind the device:
+    a sound starts at most one buffer after Play and the pool bounds how many play at once.
+    The device is opened in exactly the mixer's format; SDL converts to the hardware format if it must.
+*/
+class Mixer
+{
+public:
+    ResultBool Open(uint32 frames);
+    void Close();
+    // Starts sound; takes over an older voice of the same sound or, if the pool is full, the oldest voice.
+    void Play(const Sound& sound);
+
+private:
+    struct Voice
+    {
+        const Sound* sound = nullptr;
+        uint32 position = 0; // Next frame.
+        uint64 started = 0; // Play count when it started; lower is older.
+    };
+    
+    static void SDLCALL Callback(void* userdata, Uint8* stream, int len);
+    void Mix(float* out, uint32 frames);
+    
+    SDL_AudioDeviceID m_device = 0;
+    Voice m_voices[MIXER_VOICES];
+    uint64 m_plays = 0;
+};
+
+#endif
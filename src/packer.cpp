@@ -0,0 +1,138 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+/*
+    Packs every .bmp and .wav in a data directory into one asset bundle (see bundle.h).
+    Usage: minesweeper_packer <data directory> [<output file>]
+    The output defaults to <data directory>/data.bundle, which is where the game looks for it.
+*/
+
+#include "common.h"
+#include "bundle.h"
+#include "log.h"
+#include "mixer.h"
+
+#include <SDL.h>
+#include <algorithm> // sort
+#include <cstdio> // printf
+#include <filesystem>
+
+
+static bool PackImage(const std::string& path, BundleItem& item)
+{
+    SDL_Surface* loaded = SDL_LoadBMP(path.c_str());
+    if (!loaded)
+    {
+        LOG_FAIL("Failed to load image: %s: %s", path.c_str(), SDL_GetError());
+        return false;
+    }
+    SDL_Surface* image = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_ARGB8888, 0);
+    SDL_FreeSurface(loaded);
+    if (!image)
+    {
+        LOG_FAIL("Failed to convert image: %s: %s", path.c_str(), SDL_GetError());
+        return false;
+    }
+    
+    item.entry.type = BUNDLE_IMAGE;
+    item.entry.width = uint32(image->w);
+    item.entry.height = uint32(image->h);
+    item.entry.format = SDL_PIXELFORMAT_ARGB8888;
+    item.data.resize(MemorySize(image->w) * image->h * 4);
+    // Drop any row padding so rows are exactly width * 4 bytes.
+    for (int y = 0; y < image->h; y++)
+        std::memcpy(&item.data[MemorySize(y) * image->w * 4], static_cast<const uint8*>(image->pixels) + MemorySize(y) * image->pitch, MemorySize(image->w) * 4);
+    SDL_FreeSurface(image);
+    return true;
+}
+
+static bool PackAudio(const std::string& path, BundleItem& item)
+{
+    SDL_AudioSpec spec;
+    uint8* buf = nullptr;
+    uint32 len = 0;
+    if (!SDL_LoadWAV(path.c_str(), &spec, &buf, &len))
+    {
+        LOG_FAIL("Failed to load audio: %s: %s", path.c_str(), SDL_GetError());
+        return false;
+    }
+    
+    std::vector<float> samples;
+    ResultBool converted = ConvertWav(spec, buf, len, samples);
+    SDL_FreeWAV(buf);
+    if (!converted)
+    {
+        LOG_FAIL("%s: %s", path.c_str(), converted.error.c_str());
+        return false;
+    }
+    
+    item.entry.type = BUNDLE_AUDIO;
+    item.entry.width = BUNDLE_AUDIO_FREQUENCY;
+    item.entry.height = BUNDLE_AUDIO_CHANNELS;
+    item.entry.format = AUDIO_F32SYS;
+    item.data.resize(samples.size() * sizeof(float));
+    std::memcpy(item.data.data(), samples.data(), item.data.size());
+    return true;
+}
+
+// WARNING: SDL 2 requires this function signature; changing it will give "undefined reference to SDL_main" linker errors.
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc > 3)
+    {
+        std::printf("Usage: minesweeper_packer <data directory> [<output file>]\n");
+        return 1;
+    }
+    std::filesystem::path dir = argv[1];
+    std::filesystem::path out = (argc == 3 ? std::filesystem::path(argv[2]) : dir / BUNDLE_FILE);
+    
+    // Only the file loaders are used, so no subsystem needs initializing.
+    std::vector<std::filesystem::path> files;
+    std::error_code error;
+    for (const std::filesystem::directory_entry& e : std::filesystem::directory_iterator(dir, error))
+    {
+        std::string ext = e.path().extension().string();
+        if (e.is_regular_file() && (ext == ".bmp" || ext == ".wav"))
+            files.push_back(e.path());
+    }
+    if (error)
+    {
+        LOG_FAIL("Failed to list %s: %s", dir.string().c_str(), error.message().c_str());
+        return 1;
+    }
+    // Directory order is unspecified; sort so the same inputs always give the same bundle.
+    std::sort(files.begin(), files.end());
+    
+    std::vector<BundleItem> items;
+    for (const std::filesystem::path& file : files)
+    {
+        std::string name = file.filename().string();
+        if (name.size() >= BUNDLE_NAME_SIZE)
+        {
+            LOG_FAIL("File name is too long for a bundle entry: %s", name.c_str());
+            return 1;
+        }
+        
+        BundleItem item;
+        ZERO_STRUCT(item.entry);
+        std::memcpy(item.entry.name, name.c_str(), name.size());
+        bool packed = (file.extension() == ".bmp" ? PackImage(file.string(), item) : PackAudio(file.string(), item));
+        if (!packed)
+            return 1;
+        LOG_INFO("Packed %s (%zu bytes).", name.c_str(), item.data.size());
+        items.push_back(std::move(item));
+    }
+    
+    ResultBool written = WriteBundle(out.string(), items);
+    if (!written)
+    {
+        LOG_FAIL("%s", written.error.c_str());
+        return 1;
+    }
+    std::printf("Wrote %zu assets to %s.\n", items.size(), out.string().c_str());
+    return 0;
+}
@@ -0,0 +1,556 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+#include "probability.h"
+
+#include <algorithm> // max, min, sort
+#include <atomic>
+#include <cmath> // exp, log, lgamma
+#include <string>
+#include <thread>
+
+
+#define PROBABILITY_NO_VAR UINT32_MAX
+#define PROBABILITY_NO_STATE UINT32_MAX
+
+// A revealed number over frontier cells, which are given as positions in the component's order.
+struct FrontierConstraint
+{
+    uint32 cell;
+    uint32 need; // Mines among vars.
+    uint32 varCount;
+    uint32 vars[8];
+};
+
+struct MineProbability::Component
+{
+    std::vector<uint32> key; // Sorted cells, then every number's cell and count in cell order.
+    std::vector<uint32> cells; // In counting order.
+    std::vector<FrontierConstraint> constraints;
+    // log of the number of assignments with t mines, t = 0..cells; -inf for none.
+    std::vector<real64> logCount;
+    // Share of the t mine assignments in which cell i is a mine, at i * (cells + 1) + t.
+    std::vector<real64> ratio;
+};
+
+/*
+    States of the dynamic program between cell b - 1 and cell b: the mines still missing from each open number
+    (one with cells on both sides), and how many assignments of cells [0, b) reach the state with each mine count.
+*/
+struct CountLevel
+{
+    std::vector<uint32> open; // Open numbers; a state holds one residual per open number, in this order.
+    std::vector<uint8> residuals;
+    std::vector<real64> counts; // b + 1 per state, divided by exp(logScale).
+    real64 logScale = 0.0;
+    std::vector<uint32> next[2]; // State after cell b is safe (0) or a mine (1); PROBABILITY_NO_STATE if it breaks a number.
+};
+
+static uint64 HashKey(const std::vector<uint32>& key)
+{
+    // FNV-1a over the words.
+    uint64 h = 0xCBF29CE484222325ULL;
+    for (uint32 v : key)
+    {
+        h ^= v;
+        h *= 0x100000001B3ULL;
+    }
+    return h;
+}
+
+static real64 LogChoose(uint32 n, uint32 k)
+{
+    return std::lgamma(n + 1.0) - std::lgamma(k + 1.0) - std::lgamma(n - k + 1.0);
+}
+
+// Scales counts so the largest is 1 and returns the log of the factor; 0 if all of them are 0.
+static real64 Normalize(std::vector<real64>& counts)
+{
+    real64 largest = 0.0;
+    for (real64 v : counts)
+        largest = std::max(largest, v);
+    if (largest == 0.0)
+        return 0.0;
+    for (real64& v : counts)
+        v /= largest;
+    return std::log(largest);
+}
+
+/*
+    Forward, levels[b] counts the assignments of cells [0, b) for every state; backward, the same is done for
+    cells [b, n), and a cell is a mine in as many assignments as pair a prefix with the cell set and a suffix.
+    Counts are rescaled at every level, which keeps them inside a double however large the component.
+*/
+void MineProbability::Count(Component& comp)
+{
+    uint32 n = uint32(comp.cells.size());
+    uint32 k = uint32(comp.constraints.size());
+    std::vector<uint32> first(k, n);
+    std::vector<uint32> last(k, 0);
+    std::vector<std::vector<uint32>> starting(n);
+    for (uint32 i = 0; i < k; i++)
+    {
+        const FrontierConstraint& con = comp.constraints[i];
+        for (uint32 v = 0; v < con.varCount; v++)
+        {
+            first[i] = std::min(first[i], con.vars[v]);
+            last[i] = std::max(last[i], con.vars[v]);
+        }
+        starting[first[i]].push_back(i);
+    }
+
+    // Whether cell b is in number i, and how many of its cells come after b.
+    auto contains = [&](uint32 i, uint32 b)
+    {
+        const FrontierConstraint& con = comp.constraints[i];
+        return std::find(con.vars, con.vars + con.varCount, b) != con.vars + con.varCount;
+    };
+    auto after = [&](uint32 i, uint32 b)
+    {
+        const FrontierConstraint& con = comp.constraints[i];
+        return uint32(std::count_if(con.vars, con.vars + con.varCount, [b](uint32 v) { return v > b; }));
+    };
+
+    std::vector<CountLevel> levels(n + 1);
+    levels[0].counts.push_back(1.0);
+    std::unordered_map<std::string, uint32> states;
+    std::vector<uint8> residual;
+    for (uint32 b = 0; b < n; b++)
+    {
+        CountLevel& cur = levels[b];
+        CountLevel& nxt = levels[b + 1];
+
+        // Numbers stay open until their last cell; the ones starting at b open now, unless b is their only cell.
+        std::vector<int32> source; // Index into cur.open, or -1 for a number opening at b.
+        for (uint32 j = 0; j < cur.open.size(); j++)
+        {
+            if (last[cur.open[j]] != b)
+            {
+                nxt.open.push_back(cur.open[j]);
+                source.push_back(int32(j));
+            }
+        }
+        for (uint32 i : starting[b])
+        {
+            if (last[i] != b)
+            {
+                nxt.open.push_back(i);
+                source.push_back(-1);
+            }
+        }
+        std::vector<uint32> nxtIn(nxt.open.size());
+        std::vector<uint32> nxtAfter(nxt.open.size());
+        for (uint32 j = 0; j < nxt.open.size(); j++)
+        {
+            nxtIn[j] = contains(nxt.open[j], b);
+            nxtAfter[j] = after(nxt.open[j], b);
+        }
+
+        uint32 curWidth = uint32(cur.open.size());
+        uint32 nxtWidth = uint32(nxt.open.size());
+        uint32 stateCount = uint32(cur.counts.size()) / (b + 1);
+        cur.next[0].assign(stateCount, PROBABILITY_NO_STATE);
+        cur.next[1].assign(stateCount, PROBABILITY_NO_STATE);
+        states.clear();
+        residual.resize(nxtWidth);
+        for (uint32 s = 0; s < stateCount; s++)
+        {
+            const uint8* res = &cur.residuals[MemoryIndex(s) * curWidth];
+            for (uint32 x = 0; x <= 1; x++)
+            {
+                // Numbers whose last cell is b must be satisfied exactly.
+                bool valid = true;
+                for (uint32 j = 0; valid && j < curWidth; j++)
+                {
+                    if (last[cur.open[j]] == b)
+                        valid = (res[j] == x);
+                }
+                for (uint32 i : starting[b])
+                {
+                    if (valid && last[i] == b)
+                        valid = (comp.constraints[i].need == x);
+                }
+                for (uint32 j = 0; valid && j < nxtWidth; j++)
+                {
+                    int32 left = (source[j] >= 0 ? res[source[j]] : int32(comp.constraints[nxt.open[j]].need)) - int32(x * nxtIn[j]);
+                    valid = (left >= 0 && uint32(left) <= nxtAfter[j]);
+                    residual[j] = uint8(left);
+                }
+                if (!valid)
+                    continue;
+
+                std::string key(reinterpret_cast<const char*>(residual.data()), nxtWidth);
+                auto found = states.find(key);
+                uint32 to;
+                if (found == states.end())
+                {
+                    to = uint32(states.size());
+                    states.emplace(std::move(key), to);
+                    nxt.residuals.insert(nxt.residuals.end(), residual.begin(), residual.end());
+                    nxt.counts.resize(nxt.counts.size() + b + 2, 0.0);
+                }
+                else
+                {
+                    to = found->second;
+                }
+                cur.next[x][s] = to;
+
+                const real64* from = &cur.counts[MemoryIndex(s) * (b + 1)];
+                real64* into = &nxt.counts[MemoryIndex(to) * (b + 2) + x];
+                for (uint32 m = 0; m <= b; m++)
+                    into[m] += from[m];
+            }
+        }
+        nxt.logScale = cur.logScale + Normalize(nxt.counts);
+    }
+
+    comp.logCount.assign(n + 1, -INFINITY);
+    comp.ratio.assign(MemoryIndex(n) * (n + 1), 0.0);
+    // Every number is closed after the last cell, so at most one state is left; none if the numbers contradict.
+    if (levels[n].counts.empty())
+        return;
+    for (uint32 t = 0; t <= n; t++)
+    {
+        if (levels[n].counts[t] > 0.0)
+            comp.logCount[t] = std::log(levels[n].counts[t]) + levels[n].logScale;
+    }
+
+    std::vector<real64> suffix(1, 1.0); // Assignments of cells [b + 1, n) from each state of level b + 1, by mines.
+    real64 suffixScale = 0.0;
+    std::vector<real64> mineCounts(n + 1);
+    for (uint32 b = n; b-- > 0;)
+    {
+        const CountLevel& cur = levels[b];
+        uint32 stateCount = uint32(cur.next[0].size());
+        uint32 suffixWidth = n - b; // Mine counts 0..n - b - 1 over cells [b + 1, n).
+        std::vector<real64> prev(MemoryIndex(stateCount) * (suffixWidth + 1), 0.0);
+        std::fill(mineCounts.begin(), mineCounts.end(), 0.0);
+        for (uint32 s = 0; s < stateCount; s++)
+        {
+            for (uint32 x = 0; x <= 1; x++)
+            {
+                uint32 to = cur.next[x][s];
+                if (to == PROBABILITY_NO_STATE)
+                    continue;
+                const real64* tail = &suffix[MemoryIndex(to) * suffixWidth];
+                real64* into = &prev[MemoryIndex(s) * (suffixWidth + 1) + x];
+                for (uint32 m = 0; m < suffixWidth; m++)
+                    into[m] += tail[m];
+
+                if (x == 0)
+                    continue;
+                const real64* head = &cur.counts[MemoryIndex(s) * (b + 1)];
+                for (uint32 h = 0; h <= b; h++)
+                {
+                    if (head[h] == 0.0)
+                        continue;
+                    for (uint32 m = 0; m < suffixWidth; m++)
+                        mineCounts[h + 1 + m] += head[h] * tail[m];
+                }
+            }
+        }
+
+        for (uint32 t = 0; t <= n; t++)
+        {
+            if (mineCounts[t] > 0.0 && comp.logCount[t] > -INFINITY)
+                comp.ratio[MemoryIndex(b) * (n + 1) + t] = std::exp(std::log(mineCounts[t]) + cur.logScale + suffixScale - comp.logCount[t]);
+        }
+        suffixScale += Normalize(prev);
+        suffix.swap(prev);
+    }
+}
+
+void MineProbability::Compute(const Board& board, uint32 threads)
+{
+    uint32 cells = board.CellCount();
+    if (board.Rows() != m_rows || board.Cols() != m_cols)
+    {
+        m_rows = board.Rows();
+        m_cols = board.Cols();
+        m_var.assign(cells, PROBABILITY_NO_VAR);
+        m_cache.clear();
+    }
+    m_probability.assign(cells, 0.0f);
+    m_components.clear();
+    m_counted = 0;
+    if (board.State() != GAME_PLAYING)
+        return;
+
+    // Every revealed number with covered neighbors is a constraint on them; those neighbors are the frontier.
+    std::vector<FrontierConstraint> numbers;
+    uint32 revealed = 0;
+    for (uint32 r = 0; r < m_rows; r++)
+    {
+        const uint64* row = board.Row(PLANE_REVEALED, r);
+        for (uint32 w = 0; w < board.Stride(); w++)
+        {
+            revealed += PopCount64(row[w]);
+            for (uint64 bits = row[w]; bits; bits &= bits - 1)
+            {
+                uint32 c = w * 64 + CountTrailingZeros64(bits);
+                FrontierConstraint con;
+                con.cell = board.Index(r, c);
+                con.need = board.MinesNearby(r, c);
+                con.varCount = 0;
+                for (int32 dr = -1; dr <= 1; dr++)
+                {
+                    for (int32 dc = -1; dc <= 1; dc++)
+                    {
+                        if (!(dr || dc) || !board.InBounds(int64(r) + dr, int64(c) + dc) || board.IsRevealed(r + dr, c + dc))
+                            continue;
+                        uint32 n = board.Index(r + dr, c + dc);
+                        if (m_var[n] == PROBABILITY_NO_VAR)
+                        {
+                            m_var[n] = uint32(m_frontier.size());
+                            m_frontier.push_back(n);
+                        }
+                        con.vars[con.varCount++] = m_var[n];
+                    }
+                }
+                if (con.varCount)
+                    numbers.push_back(con);
+            }
+        }
+    }
+
+    uint32 frontier = uint32(m_frontier.size());
+    std::vector<uint32> varNumberCount(frontier, 0);
+    std::vector<uint32> varNumbers(MemoryIndex(frontier) * 8);
+    for (uint32 i = 0; i < numbers.size(); i++)
+    {
+        for (uint32 v = 0; v < numbers[i].varCount; v++)
+        {
+            uint32 var = numbers[i].vars[v];
+            varNumbers[MemoryIndex(var) * 8 + varNumberCount[var]++] = i;
+        }
+    }
+
+    // Components in breadth-first order, which keeps few numbers open at a time while counting.
+    std::vector<uint32> position(frontier, PROBABILITY_NO_VAR);
+    std::vector<uint8> numberSeen(numbers.size(), 0);
+    std::vector<uint32> compNumbers;
+    std::vector<std::shared_ptr<Component>> toCount;
+    std::unordered_map<uint64, std::shared_ptr<Component>> cache;
+    for (uint32 start = 0; start < frontier; start++)
+    {
+        if (position[start] != PROBABILITY_NO_VAR)
+            continue;
+
+        std::vector<uint32> order(1, start);
+        position[start] = 0;
+        compNumbers.clear();
+        for (uint32 q = 0; q < order.size(); q++)
+        {
+            uint32 var = order[q];
+            for (uint32 j = 0; j < varNumberCount[var]; j++)
+            {
+                uint32 i = varNumbers[MemoryIndex(var) * 8 + j];
+                if (numberSeen[i])
+                    continue;
+                numberSeen[i] = 1;
+                compNumbers.push_back(i);
+                for (uint32 v = 0; v < numbers[i].varCount; v++)
+                {
+                    uint32 u = numbers[i].vars[v];
+                    if (position[u] == PROBABILITY_NO_VAR)
+                    {
+                        position[u] = uint32(order.size());
+                        order.push_back(u);
+                    }
+                }
+            }
+        }
+
+        std::vector<uint32> key;
+        for (uint32 var : order)
+            key.push_back(m_frontier[var]);
+        std::sort(key.begin(), key.end());
+        std::sort(compNumbers.begin(), compNumbers.end(), [&](uint32 a, uint32 b) { return numbers[a].cell < numbers[b].cell; });
+        for (uint32 i : compNumbers)
+        {
+            key.push_back(numbers[i].cell);
+            key.push_back(numbers[i].need);
+        }
+
+        uint64 hash = HashKey(key);
+        auto found = m_cache.find(hash);
+        std::shared_ptr<Component> comp;
+        if (found != m_cache.end() && found->second->key == key)
+        {
+            comp = found->second;
+        }
+        else
+        {
+            comp = std::make_shared<Component>();
+            comp->key = std::move(key);
+            for (uint32 var : order)
+                comp->cells.push_back(m_frontier[var]);
+            for (uint32 i : compNumbers)
+            {
+                FrontierConstraint con = numbers[i];
+                for (uint32 v = 0; v < con.varCount; v++)
+                    con.vars[v] = position[con.vars[v]];
+                comp->constraints.push_back(con);
+            }
+            toCount.push_back(comp);
+        }
+        cache[hash] = comp;
+        m_components.push_back(comp);
+    }
+    m_cache.swap(cache);
+
+    // Components are independent; the calling thread counts too.
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = uint32(std::min<MemoryIndex>(threads, toCount.size()));
+    std::atomic<uint32> nextComp(0);
+    auto work = [&toCount, &nextComp]()
+    {
+        for (uint32 i = nextComp++; i < toCount.size(); i = nextComp++)
+            Count(*toCount[i]);
+    };
+    std::vector<std::thread> pool;
+    for (uint32 i = 1; i < threads; i++)
+        pool.emplace_back(work);
+    work();
+    for (std::thread& t : pool)
+        t.join();
+    m_counted = uint32(toCount.size());
+    for (const std::shared_ptr<Component>& comp : toCount)
+        comp->constraints.clear();
+
+    real32 interior = real32(Combine(board.Mines(), cells - revealed - frontier));
+    for (uint32 r = 0; r < m_rows; r++)
+    {
+        for (uint32 c = 0; c < m_cols; c++)
+        {
+            uint32 cell = board.Index(r, c);
+            if (!board.IsRevealed(r, c) && m_var[cell] == PROBABILITY_NO_VAR)
+                m_probability[cell] = interior;
+        }
+    }
+
+    for (uint32 var : m_frontier)
+        m_var[var] = PROBABILITY_NO_VAR;
+    m_frontier.clear();
+}
+
+/*
+    With D(M) the ways to place M mines on the frontier (the components convolved) and C(interior, mines - M)
+    the ways to place the rest, each M weighs D(M) C(interior, mines - M). A component holding t mines weighs
+    its own count times the convolution of all the others, so each component is left out of the product once,
+    using prefix and suffix products of the components around it.
+*/
+real64 MineProbability::Combine(uint32 mines, uint32 interior)
+{
+    // A distribution over mine counts, divided by exp(logScale).
+    struct Spread
+    {
+        std::vector<real64> v;
+        real64 logScale;
+    };
+    auto convolve = [](const Spread& a, const Spread& b)
+    {
+        Spread out = {std::vector<real64>(a.v.size() + b.v.size() - 1, 0.0), a.logScale + b.logScale};
+        for (MemoryIndex i = 0; i < a.v.size(); i++)
+        {
+            if (a.v[i] == 0.0)
+                continue;
+            for (MemoryIndex j = 0; j < b.v.size(); j++)
+                out.v[i + j] += a.v[i] * b.v[j];
+        }
+        out.logScale += Normalize(out.v);
+        return out;
+    };
+    auto restWeight = [mines, interior](MemoryIndex frontierMines)
+    {
+        if (frontierMines > mines || mines - frontierMines > interior)
+            return real64(-INFINITY);
+        return LogChoose(interior, uint32(mines - frontierMines));
+    };
+
+    uint32 count = uint32(m_components.size());
+    std::vector<Spread> spreads(count);
+    for (uint32 j = 0; j < count; j++)
+    {
+        const Component& comp = *m_components[j];
+        real64 largest = *std::max_element(comp.logCount.begin(), comp.logCount.end());
+        if (largest == -INFINITY)
+            return 0.0; // The numbers contradict each other; leave every probability at 0.
+        spreads[j].logScale = largest;
+        for (real64 l : comp.logCount)
+            spreads[j].v.push_back(std::exp(l - largest));
+    }
+    std::vector<Spread> prefix(count + 1);
+    std::vector<Spread> suffix(count + 1);
+    prefix[0] = {std::vector<real64>(1, 1.0), 0.0};
+    suffix[count] = prefix[0];
+    for (uint32 j = 0; j < count; j++)
+        prefix[j + 1] = convolve(prefix[j], spreads[j]);
+    for (uint32 j = count; j-- > 0;)
+        suffix[j] = convolve(spreads[j], suffix[j + 1]);
+
+    // Total weight over every frontier mine count, by log-sum-exp.
+    const Spread& all = prefix[count];
+    std::vector<real64> logWeight(all.v.size(), -INFINITY);
+    real64 largest = -INFINITY;
+    for (MemoryIndex m = 0; m < all.v.size(); m++)
+    {
+        if (all.v[m] > 0.0)
+            logWeight[m] = std::log(all.v[m]) + all.logScale + restWeight(m);
+        largest = std::max(largest, logWeight[m]);
+    }
+    if (largest == -INFINITY)
+        return 0.0; // Not enough or too many mines left for the numbers.
+    real64 total = 0.0;
+    for (real64 l : logWeight)
+        total += std::exp(l - largest);
+    real64 logTotal = largest + std::log(total);
+
+    std::vector<real64> logTerms;
+    for (uint32 j = 0; j < count; j++)
+    {
+        const Component& comp = *m_components[j];
+        Spread rest = convolve(prefix[j], suffix[j + 1]);
+        uint32 n = uint32(comp.cells.size());
+        std::vector<real64> share(n + 1, 0.0); // Probability the component holds t mines.
+        for (uint32 t = 0; t <= n; t++)
+        {
+            if (comp.logCount[t] == -INFINITY)
+                continue;
+            logTerms.clear();
+            real64 top = -INFINITY;
+            for (MemoryIndex m = 0; m < rest.v.size(); m++)
+            {
+                if (rest.v[m] == 0.0)
+                    continue;
+                logTerms.push_back(std::log(rest.v[m]) + restWeight(m + t));
+                top = std::max(top, logTerms.back());
+            }
+            if (top == -INFINITY)
+                continue;
+            real64 sum = 0.0;
+            for (real64 l : logTerms)
+                sum += std::exp(l - top);
+            share[t] = std::exp(comp.logCount[t] + rest.logScale + top + std::log(sum) - logTotal);
+        }
+        for (uint32 i = 0; i < n; i++)
+        {
+            real64 p = 0.0;
+            for (uint32 t = 0; t <= n; t++)
+                p += share[t] * comp.ratio[MemoryIndex(i) * (n + 1) + t];
+            m_probability[comp.cells[i]] = real32(std::min(p, 1.0));
+        }
+    }
+
+    if (interior == 0)
+        return 0.0;
+    real64 interiorMines = 0.0;
+    for (MemoryIndex m = 0; m < logWeight.size(); m++)
+        interiorMines += std::exp(logWeight[m] - logTotal) * (real64(mines) - real64(m));
+    return std::min(interiorMines / interior, 1.0);
+}
@@ -0,0 +1,71 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+#ifndef PROBABILITY_H
+#define PROBABILITY_H
+
+#include "common.h"
+#include "board.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+
+/*
+    Exact chance of each covered cell being a mine, from what a player can see like the Solver: which cells are
+    revealed, their counts and the board's mine total (mines and flags are never read).
+
+    Covered cells next to a revealed number form the frontier, and numbers sharing frontier cells link them into
+    independent components. A component is counted by a dynamic program over its cells in breadth-first order,
+    memoized on the mines still missing from every number it has started but not finished, so the work follows
+    the width of the frontier rather than its number of solutions. That gives, for each mine count t, how many of
+    the component's assignments hold t mines and in how many of those each cell is a mine.
+
+    All other covered cells are alike: the remaining mines fill them in C(interior, mines left) ways. Combining the
+    components with those weights gives every probability. Weights are kept as logarithms, since on large boards
+    the counts are far beyond any float.
+
+    Components are counted in parallel and kept between calls, so after a move only the ones it changed are
+    counted again.
+*/
+class MineProbability
+{
+public:
+    // Works out every cell's probability for the current position; threads 0 picks one per hardware thread.
+    // Without a game in progress every probability is 0.
+    void Compute(const Board& board, uint32 threads = 0);
+
+    // Valid after Compute; revealed cells are 0.
+    real32 Probability(uint32 cell) const { return m_probability[cell]; }
+    // Of the last Compute: frontier components, and how many of them were counted rather than kept from before.
+    uint32 Components() const { return uint32(m_components.size()); }
+    uint32 CountedComponents() const { return m_counted; }
+
+private:
+    struct Component;
+
+    // Counts the assignments of one component; touches nothing else, so components run on any thread.
+    static void Count(Component& comp);
+    // Fills in the frontier's probabilities from the counted components and returns that of every other covered cell.
+    real64 Combine(uint32 mines, uint32 interior);
+
+    uint32 m_rows = 0;
+    uint32 m_cols = 0;
+    std::vector<real32> m_probability;
+    uint32 m_counted = 0;
+    std::vector<std::shared_ptr<Component>> m_components;
+    // Components of the last Compute by the hash of their key; a component is found again only if its cells and
+    // numbers are all unchanged.
+    std::unordered_map<uint64, std::shared_ptr<Component>> m_cache;
+
+    // Scratch for Compute; frontier cells map to their index in m_frontier and back.
+    std::vector<uint32> m_var;
+    std::vector<uint32> m_frontier;
+};
+
+#endif
@@ -0,0 +1,168 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+#include "profile.h"
+#include "log.h"
+
+#include <algorithm> // min, max
+#include <chrono>
+#include <cstdio> // snprintf, fprintf
+#include <fstream>
+#include <vector>
+
+
+struct ProfileHistogram
+{
+    uint64 buckets[PROFILE_HISTOGRAM_BUCKETS];
+    uint64 count;
+    uint64 total;
+    uint64 max;
+};
+
+struct ProfileEvent
+{
+    uint64 start;
+    uint32 duration;
+    uint32 phase;
+};
+
+static const char* const PROFILE_PHASE_NAMES[PROFILE_PHASE_COUNT] =
+{
+    "wait", "events", "reveal", "draw", "present", "init cells", "load assets", "probability", "batch", "move"
+};
+
+static bool g_profileRecording = false;
+static bool g_profileTracing = false;
+static uint64 g_profileStart = 0;
+static ProfileHistogram g_profileHistograms[PROFILE_PHASE_COUNT];
+static std::vector<ProfileEvent> g_profileEvents;
+static uint64 g_profileDroppedEvents = 0;
+
+static uint32 HistogramBucket(uint64 ns)
+{
+    if (ns < 8)
+        return uint32(ns);
+    uint32 e = BitScanReverse64(ns);
+    return 8 + (e - 3) * 8 + uint32((ns >> (e - 3)) & 7);
+}
+
+// Largest value that falls in bucket i.
+static uint64 HistogramBucketMax(uint32 i)
+{
+    if (i < 8)
+        return i;
+    uint32 e = (i - 8) / 8 + 3;
+    uint64 low = uint64(8 + (i - 8) % 8) << (e - 3);
+    return low + (uint64(1) << (e - 3)) - 1;
+}
+
+static uint64 HistogramPercentile(const ProfileHistogram& h, uint32 percent)
+{
+    uint64 rank = (h.count * percent + 99) / 100;
+    uint64 seen = 0;
+    for (uint32 i = 0; i < PROFILE_HISTOGRAM_BUCKETS; i++)
+    {
+        seen += h.buckets[i];
+        if (seen >= rank && seen > 0)
+            return std::min(HistogramBucketMax(i), h.max);
+    }
+    return h.max;
+}
+
+void ProfileStart(bool trace)
+{
+    for (ProfileHistogram& h : g_profileHistograms)
+        ZERO_STRUCT(h);
+    g_profileEvents.clear();
+    // Reserve up front so recording never allocates inside a frame.
+    if (trace)
+        g_profileEvents.reserve(PROFILE_TRACE_EVENTS);
+    g_profileDroppedEvents = 0;
+    g_profileTracing = trace;
+    g_profileStart = ProfileNow();
+    g_profileRecording = true;
+}
+
+bool ProfileIsRecording()
+{
+    return g_profileRecording;
+}
+
+uint64 ProfileNow()
+{
+    return uint64(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void ProfileRecord(ProfilePhase phase, uint64 start, uint64 end)
+{
+    uint64 ns = end - start;
+    ProfileHistogram& h = g_profileHistograms[phase];
+    h.buckets[HistogramBucket(ns)]++;
+    h.count++;
+    h.total += ns;
+    h.max = std::max(h.max, ns);
+    
+    if (!g_profileTracing)
+        return;
+    if (g_profileEvents.size() == PROFILE_TRACE_EVENTS)
+    {
+        g_profileDroppedEvents++;
+        return;
+    }
+    g_profileEvents.push_back({start - g_profileStart, uint32(std::min<uint64>(ns, UINT32_MAX)), uint32(phase)});
+}
+
+void ProfileReport(FILE* file)
+{
+    if (!g_profileRecording)
+        return;
+    
+    std::fprintf(file, "Profile (us): phase count mean p50 p99 max\n");
+    for (uint32 p = 0; p < PROFILE_PHASE_COUNT; p++)
+    {
+        const ProfileHistogram& h = g_profileHistograms[p];
+        if (h.count == 0)
+            continue;
+        std::fprintf(file, "    %-12s %8" PRIu64 " %10.1f %10.1f %10.1f %10.1f\n", PROFILE_PHASE_NAMES[p], h.count, h.total / 1000.0 / h.count,
+                     HistogramPercentile(h, 50) / 1000.0, HistogramPercentile(h, 99) / 1000.0, h.max / 1000.0);
+    }
+}
+
+ResultBool ProfileWriteTrace(const std::string& path)
+{
+    ResultBool ret = {false, ""};
+    
+    std::ofstream out(path, std::ios::trunc);
+    if (!out)
+    {
+        ret.error = "Failed to open " + path + " for writing.";
+        return ret;
+    }
+    
+    // Complete ("X") events on one thread; timestamps and durations are in microseconds.
+    char line[160];
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    for (MemoryIndex i = 0; i < g_profileEvents.size(); i++)
+    {
+        const ProfileEvent& e = g_profileEvents[i];
+        std::snprintf(line, sizeof(line), "%s\n{\"name\":\"%s\",\"cat\":\"main\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                      (i ? "," : ""), PROFILE_PHASE_NAMES[e.phase], e.start / 1000.0, e.duration / 1000.0);
+        out << line;
+    }
+    out << "\n]}\n";
+    
+    if (!out)
+    {
+        ret.error = "Failed to write " + path + ".";
+        return ret;
+    }
+    if (g_profileDroppedEvents)
+        LOG_WARN("Trace is full, left out the last %" PRIu64 " events.", g_profileDroppedEvents);
+    
+    ret.result = true;
+    return ret;
+}
@@ -0,0 +1,96 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "common.h"
+
+#include <cstdio> // FILE
+
+
+/*
+    Scoped timers for the hot paths of the game loop.
+
+    PROFILE_SCOPE(phase) times the rest of the enclosing block on a monotonic nanosecond clock and adds it to
+    the phase's latency histogram, and to a Chrome trace (chrome://tracing, ui.perfetto.dev) when one is being
+    recorded. Timers do nothing until ProfileStart and cost one check each when it was not called.
+    Building with PROFILE_ENABLED 0 (the MINESWEEPER_PROFILE CMake option) compiles every timer out.
+
+    Only the main thread may record.
+*/
+
+#ifndef PROFILE_ENABLED
+    #define PROFILE_ENABLED 1
+#endif
+
+// Trace events kept in memory; later ones are counted but not recorded.
+#define PROFILE_TRACE_EVENTS (1 << 18)
+// 8 exact buckets below 8 ns, then 8 per power of two: at most 12.5% above the true value.
+#define PROFILE_HISTOGRAM_BUCKETS 496
+
+enum ProfilePhase
+{
+    PROFILE_WAIT, // Blocked in SDL_WaitEventTimeout.
+    PROFILE_EVENTS, // Handling one batch of events.
+    PROFILE_REVEAL, // Applying a reveal, chord, mark or hint to the board and the solver.
+    PROFILE_DRAW, // Queueing and batching dirty tiles into the board texture.
+    PROFILE_PRESENT, // Copying the board texture to the window and presenting it.
+    PROFILE_INIT_CELLS, // Generating a new board.
+    PROFILE_LOAD_ASSETS, // Building the tile atlas and loading sounds.
+    PROFILE_PROBABILITY, // Working out the heat map's mine probabilities.
+    PROFILE_SERVER_BATCH, // Handling every request of one read in the game server.
+    PROFILE_SERVER_MOVE, // One reveal, chord or flag in the game server.
+    PROFILE_PHASE_COUNT
+};
+
+// Starts recording every phase; with trace, also keeps each timed scope for ProfileWriteTrace.
+void ProfileStart(bool trace);
+bool ProfileIsRecording();
+// Monotonic nanoseconds.
+uint64 ProfileNow();
+void ProfileRecord(ProfilePhase phase, uint64 start, uint64 end);
+// Prints count, mean, p50, p99 and max of every phase that was timed to file.
+void ProfileReport(FILE* file);
+// Writes the recorded scopes as Chrome trace_event JSON.
+ResultBool ProfileWriteTrace(const std::string& path);
+
+class ProfileScope
+{
+public:
+    explicit ProfileScope(ProfilePhase phase) : m_phase(phase), m_active(ProfileIsRecording()), m_start(m_active ? ProfileNow() : 0) {}
+    ~ProfileScope() { Stop(); }
+    
+    // Records the time so far; the scope records nothing more after this.
+    void Stop()
+    {
+        if (m_active)
+            ProfileRecord(m_phase, m_start, ProfileNow());
+        m_active = false;
+    }
+
+private:
+    ProfilePhase m_phase;
+    bool m_active;
+    uint64 m_start;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+// PROFILE_START/PROFILE_STOP time part of a block without adding a scope around it.
+#if PROFILE_ENABLED
+    #define PROFILE_SCOPE(phase) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(phase)
+    #define PROFILE_START(name, phase) ProfileScope name(phase)
+    #define PROFILE_STOP(name) name.Stop()
+#else
+    #define PROFILE_SCOPE(phase) ((void)0)
+    #define PROFILE_START(name, phase) ((void)0)
+    #define PROFILE_STOP(name) ((void)0)
+#endif
+
+#endif
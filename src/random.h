@@ -0,0 +1,72 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include "common.h"
+
+
+// Advances state and returns the next splitmix64 output; used to expand one 64 bit seed into more.
+inline uint64 SplitMix64(uint64& state)
+{
+    uint64 z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// xoshiro256** (Blackman and Vigna); the same seed always produces the same sequence.
+class Random
+{
+public:
+    explicit Random(uint64 seed = 0) { Seed(seed); }
+    
+    void Seed(uint64 seed)
+    {
+        for (uint32 i = 0; i < 4; i++)
+            m_s[i] = SplitMix64(seed);
+    }
+    
+    uint64 Next()
+    {
+        uint64 result = Rotl(m_s[1] * 5, 7) * 9;
+        uint64 t = m_s[1] << 17;
+        m_s[2] ^= m_s[0];
+        m_s[3] ^= m_s[1];
+        m_s[1] ^= m_s[2];
+        m_s[0] ^= m_s[3];
+        m_s[2] ^= t;
+        m_s[3] = Rotl(m_s[3], 45);
+        return result;
+    }
+    
+    // Uniform in [0, bound) without modulo bias (Lemire's multiply and reject).
+    uint32 Below(uint32 bound)
+    {
+        assert(bound > 0);
+        uint64 m = (Next() >> 32) * bound;
+        uint32 low = uint32(m);
+        if (low < bound)
+        {
+            uint32 threshold = uint32(-bound) % bound;
+            while (low < threshold)
+            {
+                m = (Next() >> 32) * bound;
+                low = uint32(m);
+            }
+        }
+        return uint32(m >> 32);
+    }
+
+private:
+    static uint64 Rotl(uint64 x, int k) { return (x << k) | (x >> (64 - k)); }
+    
+    uint64 m_s[4];
+};
+
+#endif
@@ -0,0 +1,230 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+#include "replay.h"
+
+
+static bool HasCell(InputAction action) { return action == INPUT_REVEAL || action == INPUT_CHORD || action == INPUT_MARK; }
+
+static uint64 ZigZag(int64 v) { return (uint64(v) << 1) ^ uint64(v >> 63); }
+static int64 UnZigZag(uint64 v) { return int64(v >> 1) ^ -int64(v & 1); }
+
+static void WriteVarint(std::vector<uint8>& out, uint64 v)
+{
+    while (v >= 0x80)
+    {
+        out.push_back(uint8(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(uint8(v));
+}
+
+void NewGame(Board& board, Solver& solver, Random& rng)
+{
+    board.Generate(rng.Next());
+    solver.Reset(board);
+}
+
+InputResult ApplyInput(Board& board, Solver& solver, Random& rng, const InputEvent& input)
+{
+    InputResult result;
+    uint32 r = input.cell / board.Cols();
+    uint32 c = input.cell % board.Cols();
+    if (input.action == INPUT_REVEAL || input.action == INPUT_CHORD)
+    {
+        result.move = (input.action == INPUT_REVEAL ? board.Reveal(r, c) : board.Chord(r, c));
+        result.changed = (result.move != MOVE_NONE);
+        solver.Track(board);
+    }
+    else if (input.action == INPUT_MARK)
+    {
+        board.CycleMark(r, c);
+        result.changed = !board.Changed().empty();
+        solver.Track(board);
+    }
+    else if (input.action == INPUT_HINT && board.State() == GAME_PLAYING)
+    {
+        // Safe cells first; a provable mine only gets a flag, which the solver never reads.
+        uint32 cell;
+        if (solver.NextSafe(board, cell))
+        {
+            r = cell / board.Cols();
+            c = cell % board.Cols();
+            board.SetFlagged(r, c, false);
+            board.SetGuessed(r, c, false);
+            result.move = board.Reveal(r, c);
+            result.changed = true;
+            solver.Track(board);
+        }
+        else if (solver.NextMine(board, cell))
+        {
+            board.SetGuessed(cell / board.Cols(), cell % board.Cols(), false);
+            board.SetFlagged(cell / board.Cols(), cell % board.Cols(), true);
+            result.flagged = cell;
+        }
+    }
+    else if (input.action == INPUT_NEW_GAME)
+    {
+        NewGame(board, solver, rng);
+    }
+    
+    return result;
+}
+
+ResultBool InputRecorder::Open(const std::string& path, uint32 rows, uint32 cols, uint32 mines, uint64 seed)
+{
+    ResultBool ret = {false, ""};
+    Close();
+    
+    m_out.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_out)
+    {
+        ret.error = "Failed to open " + path + " for writing.";
+        return ret;
+    }
+    
+    ReplayHeader header = {REPLAY_MAGIC, REPLAY_VERSION, rows, cols, mines, 0, seed};
+    m_out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_buffer.clear();
+    m_buffer.reserve(REPLAY_WRITE_BUFFER + 32);
+    m_time = 0;
+    m_cell = 0;
+    
+    ret.result = true;
+    return ret;
+}
+
+ResultBool InputRecorder::Close()
+{
+    ResultBool ret = {false, ""};
+    if (!m_out.is_open())
+    {
+        ret.result = true;
+        return ret;
+    }
+    
+    m_out.write(reinterpret_cast<const char*>(m_buffer.data()), std::streamsize(m_buffer.size()));
+    m_buffer.clear();
+    bool ok = bool(m_out);
+    m_out.close();
+    if (!ok)
+    {
+        ret.error = "Failed to write the input recording.";
+        return ret;
+    }
+    
+    ret.result = true;
+    return ret;
+}
+
+void InputRecorder::Record(const InputEvent& input)
+{
+    // Times only go forward; a clock that stepped back records as no delay.
+    uint64 delta = (input.time > m_time ? input.time - m_time : 0);
+    m_time += delta;
+    WriteVarint(m_buffer, (delta << 3) | uint64(input.action));
+    if (HasCell(input.action))
+    {
+        WriteVarint(m_buffer, ZigZag(int64(input.cell) - int64(m_cell)));
+        m_cell = input.cell;
+    }
+    
+    if (m_buffer.size() >= REPLAY_WRITE_BUFFER)
+    {
+        m_out.write(reinterpret_cast<const char*>(m_buffer.data()), std::streamsize(m_buffer.size()));
+        m_buffer.clear();
+    }
+}
+
+ResultBool InputReplay::Open(const std::string& path)
+{
+    ResultBool ret = {false, ""};
+    m_data.clear();
+    m_pos = 0;
+    m_time = 0;
+    m_cell = 0;
+    m_failed = false;
+    
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in)
+    {
+        ret.error = "Failed to open " + path + ".";
+        return ret;
+    }
+    std::vector<uint8> data(MemorySize(in.tellg()));
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(data.data()), std::streamsize(data.size()));
+    if (!in)
+    {
+        ret.error = "Failed to read " + path + ".";
+        return ret;
+    }
+    
+    if (data.size() < sizeof(ReplayHeader))
+    {
+        ret.error = path + " is not an input recording.";
+        return ret;
+    }
+    std::memcpy(&m_header, data.data(), sizeof(ReplayHeader));
+    if (m_header.magic != REPLAY_MAGIC || m_header.version != REPLAY_VERSION)
+    {
+        ret.error = path + " is not a version " + std::to_string(REPLAY_VERSION) + " input recording.";
+        return ret;
+    }
+    
+    m_data = std::move(data);
+    m_pos = sizeof(ReplayHeader);
+    ret.result = true;
+    return ret;
+}
+
+bool InputReplay::ReadVarint(uint64& v)
+{
+    v = 0;
+    for (uint32 shift = 0; shift < 64; shift += 7)
+    {
+        if (m_pos == m_data.size())
+            return false;
+        uint8 b = m_data[m_pos++];
+        v |= uint64(b & 0x7F) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+bool InputReplay::Next(InputEvent& input)
+{
+    if (m_failed || m_pos >= m_data.size())
+        return false;
+    
+    uint64 head;
+    if (!ReadVarint(head) || (head & 7) >= INPUT_ACTION_COUNT)
+    {
+        m_failed = true;
+        return false;
+    }
+    m_time += head >> 3;
+    input.time = m_time;
+    input.action = InputAction(head & 7);
+    input.cell = BOARD_NO_CELL;
+    if (HasCell(input.action))
+    {
+        uint64 delta;
+        int64 cell = -1;
+        if (ReadVarint(delta))
+            cell = int64(m_cell) + UnZigZag(delta);
+        if (cell < 0 || cell >= int64(m_header.rows) * m_header.cols)
+        {
+            m_failed = true;
+            return false;
+        }
+        m_cell = uint32(cell);
+        input.cell = m_cell;
+    }
+    return true;
+}
@@ -0,0 +1,127 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "common.h"
+#include "board.h"
+#include "random.h"
+#include "solver.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+/*
+    Input recordings: the random seed a session started with plus every input it applied, so playing the inputs
+    back through ApplyInput rebuilds every board exactly.
+
+    Layout (little endian):
+        ReplayHeader
+        events until the end of the file, each:
+            varint: milliseconds since the previous event << 3 | InputAction
+            varint: zigzag(cell - previous event's cell), only for actions on a cell
+    Clicks on nearby cells at human speed take two or three bytes each.
+*/
+
+#define REPLAY_MAGIC 0x5052534D // "MSRP"
+#define REPLAY_VERSION 2
+// Encoded events buffered before the recorder writes them out.
+#define REPLAY_WRITE_BUFFER KIBIBYTES(64)
+
+enum InputAction
+{
+    INPUT_REVEAL, // Left-click on a cell.
+    INPUT_CHORD, // Middle-click on a cell.
+    INPUT_MARK, // Right-click on a cell.
+    INPUT_HINT, // H: play one move the solver has proven.
+    INPUT_NEW_GAME, // Any click after the game ended.
+    INPUT_ACTION_COUNT
+};
+
+static_assert(INPUT_ACTION_COUNT <= 8, "Actions are packed into three bits.");
+
+struct InputEvent
+{
+    uint64 time; // Milliseconds since the recording started.
+    InputAction action;
+    uint32 cell; // Board index; BOARD_NO_CELL for actions without one.
+};
+
+struct ReplayHeader
+{
+    uint32 magic;
+    uint32 version;
+    uint32 rows;
+    uint32 cols;
+    uint32 mines;
+    uint32 reserved;
+    uint64 seed; // Seeds the Random that draws every board's seed, the first one included.
+};
+
+static_assert(sizeof(ReplayHeader) == 32, "ReplayHeader is written as is.");
+
+// What ApplyInput did, for the caller to redraw and play sounds.
+struct InputResult
+{
+    MoveResult move = MOVE_NONE; // Of the reveal or chord, hinted reveals included.
+    bool changed = false; // Board::Changed() lists the cells the input changed.
+    uint32 flagged = BOARD_NO_CELL; // A provable mine a hint flagged; it is not in Changed().
+};
+
+// Starts the next game: the board's seed is the next number from rng.
+void NewGame(Board& board, Solver& solver, Random& rng);
+// Applies one input to the board and keeps the solver following it; the game, the recorder and replays all go through here.
+InputResult ApplyInput(Board& board, Solver& solver, Random& rng, const InputEvent& input);
+
+class InputRecorder
+{
+public:
+    ~InputRecorder() { Close(); }
+    
+    // Creates the file and writes the header; the caller then starts the first game with NewGame.
+    ResultBool Open(const std::string& path, uint32 rows, uint32 cols, uint32 mines, uint64 seed);
+    // Writes any buffered events and closes the file.
+    ResultBool Close();
+    bool IsOpen() const { return m_out.is_open(); }
+    
+    void Record(const InputEvent& input);
+
+private:
+    std::ofstream m_out;
+    std::vector<uint8> m_buffer;
+    uint64 m_time = 0;
+    uint32 m_cell = 0;
+};
+
+// A recording loaded into memory and decoded one event at a time.
+class InputReplay
+{
+public:
+    // Reads the whole file and validates the header.
+    ResultBool Open(const std::string& path);
+    bool IsOpen() const { return !m_data.empty(); }
+    const ReplayHeader& Header() const { return m_header; }
+    
+    // Decodes the next event; false at the end of the recording or if the rest of it is corrupt (see Failed).
+    bool Next(InputEvent& input);
+    bool Failed() const { return m_failed; }
+
+private:
+    bool ReadVarint(uint64& v);
+    
+    std::vector<uint8> m_data;
+    MemoryIndex m_pos = 0;
+    ReplayHeader m_header = {};
+    uint64 m_time = 0;
+    uint32 m_cell = 0;
+    bool m_failed = false;
+};
+
+#endif
@@ -0,0 +1,258 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+#include "save.h"
+
+#if defined(OS_WINDOWS)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <fcntl.h> // open
+    #include <sys/mman.h> // mmap
+    #include <sys/stat.h> // fstat
+    #include <unistd.h> // close, write, fsync
+#endif
+#include <algorithm> // min
+#include <cerrno> // errno, EINTR
+#include <cstdio> // rename, remove
+
+
+static const BoardPlane SAVE_PLANE_ORDER[SAVE_PLANES] = {PLANE_MINE, PLANE_REVEALED, PLANE_FLAGGED, PLANE_GUESSED};
+
+// A whole file mapped into memory for reading.
+struct SaveMapping
+{
+    uint8* data = nullptr;
+    MemorySize size = 0;
+#if defined(OS_WINDOWS)
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+};
+
+static void Unmap(SaveMapping& m)
+{
+#if defined(OS_WINDOWS)
+    if (m.data)
+        UnmapViewOfFile(m.data);
+    if (m.mapping)
+        CloseHandle(m.mapping);
+    if (m.file != INVALID_HANDLE_VALUE)
+        CloseHandle(m.file);
+    m.mapping = nullptr;
+    m.file = INVALID_HANDLE_VALUE;
+#else
+    if (m.data)
+        munmap(m.data, m.size);
+#endif
+    m.data = nullptr;
+    m.size = 0;
+}
+
+// Maps path for reading; size is set to the file's size.
+static bool Map(SaveMapping& m, const std::string& path)
+{
+#if defined(OS_WINDOWS)
+    m.file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m.file == INVALID_HANDLE_VALUE)
+        return false;
+    
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(m.file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        Unmap(m);
+        return false;
+    }
+    m.mapping = CreateFileMappingA(m.file, nullptr, PAGE_READONLY, DWORD(uint64(fileSize.QuadPart) >> 32), DWORD(fileSize.QuadPart), nullptr);
+    if (m.mapping)
+        m.data = static_cast<uint8*>(MapViewOfFile(m.mapping, FILE_MAP_READ, 0, 0, 0));
+    m.size = MemorySize(fileSize.QuadPart);
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        data = mmap(nullptr, MemorySize(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping keeps the file alive on its own.
+    close(fd);
+    if (data != MAP_FAILED)
+    {
+        m.data = static_cast<uint8*>(data);
+        m.size = MemorySize(st.st_size);
+    }
+#endif
+
+    if (!m.data)
+    {
+        Unmap(m);
+        return false;
+    }
+    return true;
+}
+
+struct SaveChunk
+{
+    const void* data;
+    MemorySize size;
+};
+
+/*
+    Writes chunks one after another to path + ".tmp", flushes it to the disk and renames it over path, so path
+    always holds either the old file or the whole new one. A full disk or any other write error leaves the old file
+    as it was and removes the temporary one.
+*/
+static bool WriteReplacing(const std::string& path, const SaveChunk* chunks, uint32 count)
+{
+    std::string temp = path + ".tmp";
+#if defined(OS_WINDOWS)
+    HANDLE file = CreateFileA(temp.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    
+    bool written = true;
+    for (uint32 i = 0; i < count && written; i++)
+    {
+        const uint8* data = static_cast<const uint8*>(chunks[i].data);
+        MemorySize left = chunks[i].size;
+        while (left > 0 && written)
+        {
+            DWORD n = 0;
+            written = WriteFile(file, data, DWORD(std::min<MemorySize>(left, GIBIBYTES(1))), &n, nullptr) && n > 0;
+            data += n;
+            left -= n;
+        }
+    }
+    written = written && FlushFileBuffers(file);
+    written = CloseHandle(file) && written;
+    if (!written || !MoveFileExA(temp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+    {
+        DeleteFileA(temp.c_str());
+        return false;
+    }
+#else
+    int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+    
+    bool written = true;
+    for (uint32 i = 0; i < count && written; i++)
+    {
+        const uint8* data = static_cast<const uint8*>(chunks[i].data);
+        MemorySize left = chunks[i].size;
+        while (left > 0 && written)
+        {
+            ssize_t n = write(fd, data, left);
+            if (n < 0 && errno == EINTR)
+                continue;
+            written = (n > 0);
+            if (written)
+            {
+                data += n;
+                left -= MemorySize(n);
+            }
+        }
+    }
+    // Delayed write-back errors such as a full disk surface here at the latest.
+    written = written && fsync(fd) == 0;
+    written = (close(fd) == 0) && written;
+    if (!written || std::rename(temp.c_str(), path.c_str()) != 0)
+    {
+        std::remove(temp.c_str());
+        return false;
+    }
+    
+    // Make the rename itself durable.
+    MemoryIndex slash = path.find_last_of('/');
+    int dir = open(slash == std::string::npos ? "." : path.substr(0, slash + 1).c_str(), O_RDONLY);
+    if (dir >= 0)
+    {
+        fsync(dir);
+        close(dir);
+    }
+#endif
+    return true;
+}
+
+ResultBool SaveBoard(const Board& board, const std::string& path)
+{
+    ResultBool ret = {false, ""};
+    
+    SaveHeader header;
+    ZERO_STRUCT(header);
+    header.magic = SAVE_MAGIC;
+    header.version = SAVE_VERSION;
+    header.rows = board.Rows();
+    header.cols = board.Cols();
+    header.mines = board.Mines();
+    header.stride = board.Stride();
+    header.exploded = board.Exploded();
+    header.seed = board.Seed();
+    
+    // Each plane's rows are contiguous in the board, so a plane is written straight from it.
+    MemorySize planeBytes = MemorySize(board.Rows()) * board.Stride() * sizeof(uint64);
+    SaveChunk chunks[1 + SAVE_PLANES];
+    chunks[0] = {&header, sizeof(header)};
+    for (uint32 p = 0; p < SAVE_PLANES; p++)
+        chunks[1 + p] = {board.Row(SAVE_PLANE_ORDER[p], 0), planeBytes};
+    if (!WriteReplacing(path, chunks, ARRAY_COUNT(chunks)))
+    {
+        ret.error = "Failed to write " + path + "; the previous save is unchanged.";
+        return ret;
+    }
+    
+    ret.result = true;
+    return ret;
+}
+
+ResultBool LoadBoard(Board& board, const std::string& path)
+{
+    ResultBool ret = {false, ""};
+    
+    SaveMapping m;
+    if (!Map(m, path))
+    {
+        ret.error = "Failed to open " + path + ".";
+        return ret;
+    }
+    
+    SaveHeader header;
+    if (m.size >= sizeof(header))
+        std::memcpy(&header, m.data, sizeof(header));
+    if (m.size < sizeof(header) || header.magic != SAVE_MAGIC || header.version != SAVE_VERSION)
+    {
+        Unmap(m);
+        ret.error = path + " is not a version " + std::to_string(SAVE_VERSION) + " save.";
+        return ret;
+    }
+    
+    ResultBool boardInit = board.Init(header.rows, header.cols, header.mines);
+    MemorySize planeBytes = MemorySize(board.Rows()) * board.Stride() * sizeof(uint64);
+    if (!boardInit || header.stride != board.Stride() || m.size != sizeof(SaveHeader) + planeBytes * SAVE_PLANES)
+    {
+        Unmap(m);
+        ret.error = path + " is corrupt" + (boardInit ? "." : ": " + boardInit.error);
+        return ret;
+    }
+    
+    for (uint32 p = 0; p < SAVE_PLANES; p++)
+        std::memcpy(board.Row(SAVE_PLANE_ORDER[p], 0), m.data + sizeof(SaveHeader) + planeBytes * p, planeBytes);
+    Unmap(m);
+    
+    ResultBool restored = board.Restore(header.seed, header.exploded);
+    if (!restored)
+    {
+        board.Clear();
+        ret.error = path + " is corrupt: " + restored.error;
+        return ret;
+    }
+    
+    ret.result = true;
+    return ret;
+}
@@ -0,0 +1,56 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+#ifndef SAVE_H
+#define SAVE_H
+
+#include "common.h"
+#include "board.h"
+
+#include <string>
+
+
+/*
+    Saved games: the board's own bitplanes written out as is, about 4 bits per cell.
+
+    Layout (little endian):
+        SaveHeader
+        SAVE_PLANES planes (PLANE_MINE, PLANE_REVEALED, PLANE_FLAGGED, PLANE_GUESSED),
+        each rows * stride 64 bit words, rows padded to whole words with zero bits.
+    Neighbor counts, the revealed count and the game state are rebuilt on load (Board::Restore).
+    A save is written to <path>.tmp one plane at a time straight from the board, flushed to the disk and renamed
+    over the old save, so a full disk or a crash mid-save never costs the previous one. Loads go through a memory
+    mapping: one copy per plane and no parsing.
+*/
+
+#define SAVE_MAGIC 0x5653534D // "MSSV"
+#define SAVE_VERSION 1
+#define SAVE_PLANES 4
+#define SAVE_DEFAULT_FILE "minesweeper.save"
+
+struct SaveHeader
+{
+    uint32 magic;
+    uint32 version;
+    uint32 rows;
+    uint32 cols;
+    uint32 mines;
+    uint32 stride; // 64 bit words per plane row.
+    uint32 exploded; // Cell the game was lost on, or BOARD_NO_CELL.
+    uint32 reserved0;
+    uint64 seed; // Seed the board was generated from.
+    uint64 reserved[3];
+};
+
+static_assert(sizeof(SaveHeader) == 64, "SaveHeader is written as is and keeps the planes 64 byte aligned.");
+
+ResultBool SaveBoard(const Board& board, const std::string& path);
+// Replaces board with the saved one, resizing it if needed. A save that turns out to be invalid may leave the board
+// cleared, so load into a spare Board when the current game has to survive a bad file.
+ResultBool LoadBoard(Board& board, const std::string& path);
+
+#endif
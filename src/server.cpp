@@ -0,0 +1,758 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+/*
+    Keeps many independent games in one process and plays them for clients, one request per line.
+
+    Clients talk over stdin and stdout (default) or, on Linux, connect to a Unix domain socket (--socket <path>).
+    Every request gets exactly one response line, in order; blank lines and lines starting with '#' get none.
+        new <rows> <cols> <mines> [seed]    ok <game> <seed>
+        reveal <game> <row> <col>           ok <state> <n> <cell>:<count> ... ('*' for the mine that exploded)
+        chord <game> <row> <col>            as reveal
+        flag <game> <row> <col>             ok <1 if now flagged, 0 if not>
+        query <game>                        ok <state> <rows> <cols> <mines> <revealed> <cells>
+        end <game>                          ok
+        stats                               ok <games> <requests> <moves>
+    Failures answer "err <message>". State is playing, won or lost; cells are row * cols + col. query prints one
+    character per cell, row after row, like headless --print: '#' covered, 'F' flagged, '?' guessed, '*' exploded
+    and digits for revealed cells; once the game is over, 'M' shows the other mines.
+    Commands may be shortened to their first letter.
+
+    Games live in a pool of slots whose id is the game number. A slot freed by end keeps its board's memory for the
+    next new game, so games of the same size never allocate once the pool has grown.
+    Requests are handled in batches: everything one read brings in is answered with one write. A batch stops once
+    SERVER_MAX_OUTPUT bytes of answers are waiting, and the rest of its lines are answered after those are written.
+*/
+
+#include "common.h"
+#include "args.h"
+#include "board.h"
+#include "log.h"
+#include "profile.h"
+#include "random.h"
+
+#include <algorithm> // min
+#include <cerrno> // errno, EINTR
+#include <charconv> // to_chars
+#include <chrono>
+#include <csignal> // signal, sig_atomic_t
+#include <cstdio> // fprintf
+#include <ctime> // time
+#include <vector>
+
+#if defined(OS_WINDOWS)
+    #include <io.h> // _read, _write
+#else
+    #include <fcntl.h> // fcntl
+    #include <poll.h> // poll
+    #include <sys/socket.h> // socket, bind, listen, accept, send
+    #include <sys/un.h> // sockaddr_un
+    #include <unistd.h> // read, write, close, unlink
+#endif
+
+
+#define SERVER_MAX_GAMES (1 << 16)
+// Cells of every game together, so no client can take all the memory.
+#define SERVER_MAX_CELLS (uint64(1) << 28)
+#define SERVER_MAX_LINE KIBIBYTES(4)
+#define SERVER_MAX_CLIENTS 256
+#define SERVER_READ_SIZE KIBIBYTES(64)
+#define SERVER_MAX_WORDS 6
+// Answers queued for one client before its batch waits for them to be written; one query can still go past it.
+#define SERVER_MAX_OUTPUT MEBIBYTES(4)
+
+struct ServerGame
+{
+    Board board;
+    uint64 seed = 0;
+    bool live = false;
+};
+
+struct ServerStats
+{
+    uint64 requests = 0;
+    uint64 moves = 0;
+    uint64 errors = 0;
+    uint64 batches = 0;
+    uint64 games = 0; // Started by new, ended or not.
+    uint64 busyNanoseconds = 0; // Spent handling batches.
+};
+
+// Bytes read from one client that do not make a whole line yet, and responses not written yet.
+struct ServerClient
+{
+    int in = -1;
+    int out = -1;
+    std::string input;
+    std::string output;
+    bool discarding = false; // The current line was too long; drop it up to its newline.
+    bool closing = false; // No more input; close once output is written.
+    bool pending = false; // The last batch stopped at SERVER_MAX_OUTPUT; input still has lines to answer.
+};
+
+static std::vector<ServerGame> g_games; // Indexed by game id.
+static std::vector<uint32> g_freeGames; // Ids of slots without a live game, reused first.
+static uint32 g_liveGames = 0;
+static uint64 g_liveCells = 0;
+static Random g_seeds; // Seeds of games started without one.
+static ServerStats g_stats;
+static uint64 g_reportTime = 0; // When ReportProgress last logged, or serving started.
+static uint64 g_reportRequests = 0;
+static volatile std::sig_atomic_t g_stop = 0;
+
+static void StopSignal(int)
+{
+    g_stop = 1;
+}
+
+static void AppendUint(std::string& out, uint64 v)
+{
+    char digits[24];
+    std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), v);
+    out.append(digits, result.ptr);
+}
+
+static void AppendError(std::string& out, const char* message)
+{
+    out += "err ";
+    out += message;
+    out += '\n';
+    g_stats.errors++;
+}
+
+static const char* StateName(GameState state)
+{
+    if (state == GAME_WON)
+        return "won";
+    else if (state == GAME_LOST)
+        return "lost";
+    else
+        return "playing";
+}
+
+// Splits line into words in place; returns how many, at most SERVER_MAX_WORDS + 1 so extra words can be rejected.
+static uint32 SplitWords(char* line, char* words[SERVER_MAX_WORDS + 1])
+{
+    uint32 count = 0;
+    char* p = line;
+    while (count <= SERVER_MAX_WORDS)
+    {
+        while (*p == ' ' || *p == '\t' || *p == '\r')
+            p++;
+        if (!*p)
+            break;
+        words[count++] = p;
+        while (*p && *p != ' ' && *p != '\t' && *p != '\r')
+            p++;
+        if (*p)
+            *p++ = '\0';
+    }
+    return count;
+}
+
+// True if word is command or its first letter.
+static bool IsCommand(const char* word, const char* command)
+{
+    return (word[0] == command[0] && word[1] == '\0') || std::strcmp(word, command) == 0;
+}
+
+static ServerGame* FindGame(const char* word)
+{
+    uint32 id;
+    if (!ParseUint32(word, id) || id >= g_games.size() || !g_games[id].live)
+        return nullptr;
+    return &g_games[id];
+}
+
+static void NewGame(char* words[], uint32 count, std::string& out)
+{
+    uint32 rows;
+    uint32 cols;
+    uint32 mines;
+    uint64 seed = 0;
+    if (count < 4 || count > 5 || !ParseUint32(words[1], rows) || !ParseUint32(words[2], cols) || !ParseUint32(words[3], mines) ||
+        (count == 5 && !ParseUint64(words[4], seed)))
+    {
+        AppendError(out, "Expected new <rows> <cols> <mines> [seed].");
+        return;
+    }
+    if (g_liveGames == SERVER_MAX_GAMES)
+    {
+        AppendError(out, "Too many games; end one first.");
+        return;
+    }
+    if (g_liveCells + uint64(rows) * cols > SERVER_MAX_CELLS)
+    {
+        AppendError(out, "Too many cells in play; end a game first.");
+        return;
+    }
+    
+    uint32 id;
+    if (!g_freeGames.empty())
+    {
+        id = g_freeGames.back();
+        g_freeGames.pop_back();
+    }
+    else
+    {
+        id = uint32(g_games.size());
+        g_games.emplace_back();
+    }
+    
+    ServerGame& game = g_games[id];
+    ResultBool boardInit = game.board.Init(rows, cols, mines);
+    if (!boardInit)
+    {
+        g_freeGames.push_back(id);
+        AppendError(out, boardInit.error.c_str());
+        return;
+    }
+    game.seed = (count == 5 ? seed : g_seeds.Next());
+    game.board.Generate(game.seed);
+    game.live = true;
+    g_liveGames++;
+    g_liveCells += game.board.CellCount();
+    g_stats.games++;
+    
+    out += "ok ";
+    AppendUint(out, id);
+    out += ' ';
+    AppendUint(out, game.seed);
+    out += '\n';
+}
+
+static void EndGame(ServerGame& game)
+{
+    game.live = false;
+    g_liveGames--;
+    g_liveCells -= game.board.CellCount();
+    g_freeGames.push_back(uint32(&game - g_games.data()));
+}
+
+// reveal, chord and flag: <game> <row> <col>.
+static void Move(char* words[], uint32 count, std::string& out)
+{
+    ServerGame* game = (count == 4 ? FindGame(words[1]) : nullptr);
+    if (!game)
+    {
+        AppendError(out, (count == 4 ? "No such game." : "Expected <game> <row> <col>."));
+        return;
+    }
+    Board& board = game->board;
+    uint32 u;
+    int64 r = (ParseUint32(words[2], u) ? int64(u) : -1);
+    int64 c = (ParseUint32(words[3], u) ? int64(u) : -1);
+    if (!board.InBounds(r, c))
+    {
+        AppendError(out, "Cell is outside the board.");
+        return;
+    }
+    g_stats.moves++;
+    PROFILE_SCOPE(PROFILE_SERVER_MOVE);
+    
+    if (IsCommand(words[0], "flag"))
+    {
+        // Toggles the flag instead of cycling through guessed like the right mouse button does.
+        if (board.State() == GAME_PLAYING && !board.IsRevealed(uint32(r), uint32(c)))
+        {
+            board.SetFlagged(uint32(r), uint32(c), !board.IsFlagged(uint32(r), uint32(c)));
+            board.SetGuessed(uint32(r), uint32(c), false);
+        }
+        out += (board.IsFlagged(uint32(r), uint32(c)) ? "ok 1\n" : "ok 0\n");
+        return;
+    }
+    
+    if (IsCommand(words[0], "reveal"))
+        board.Reveal(uint32(r), uint32(c));
+    else
+        board.Chord(uint32(r), uint32(c));
+    
+    const std::vector<uint32>& changed = board.Changed();
+    out += "ok ";
+    out += StateName(board.State());
+    out += ' ';
+    AppendUint(out, changed.size());
+    for (uint32 cell : changed)
+    {
+        uint32 cr = cell / board.Cols();
+        uint32 cc = cell % board.Cols();
+        out += ' ';
+        AppendUint(out, cell);
+        out += ':';
+        out += (board.IsExploded(cr, cc) ? '*' : char('0' + board.MinesNearby(cr, cc)));
+    }
+    out += '\n';
+}
+
+static void Query(const ServerGame& game, std::string& out)
+{
+    const Board& board = game.board;
+    bool over = (board.State() != GAME_PLAYING);
+    out += "ok ";
+    out += StateName(board.State());
+    out += ' ';
+    AppendUint(out, board.Rows());
+    out += ' ';
+    AppendUint(out, board.Cols());
+    out += ' ';
+    AppendUint(out, board.Mines());
+    out += ' ';
+    AppendUint(out, board.RevealedCount());
+    out += ' ';
+    out.reserve(out.size() + board.CellCount() + 1);
+    for (uint32 r = 0; r < board.Rows(); r++)
+    {
+        for (uint32 c = 0; c < board.Cols(); c++)
+        {
+            if (board.IsExploded(r, c))
+                out += '*';
+            else if (board.IsRevealed(r, c))
+                out += char('0' + board.MinesNearby(r, c));
+            else if (over && board.IsMine(r, c))
+                out += 'M';
+            else if (board.IsFlagged(r, c))
+                out += 'F';
+            else if (board.IsGuessed(r, c))
+                out += '?';
+            else
+                out += '#';
+        }
+    }
+    out += '\n';
+}
+
+// Answers one request line, appending exactly one response line unless the line is blank or a comment.
+static void HandleRequest(char* line, std::string& out)
+{
+    char* words[SERVER_MAX_WORDS + 1];
+    uint32 count = SplitWords(line, words);
+    if (count == 0 || words[0][0] == '#')
+        return;
+    
+    g_stats.requests++;
+    if (count > SERVER_MAX_WORDS)
+    {
+        AppendError(out, "Too many words.");
+    }
+    else if (IsCommand(words[0], "reveal") || IsCommand(words[0], "chord") || IsCommand(words[0], "flag"))
+    {
+        Move(words, count, out);
+    }
+    else if (IsCommand(words[0], "new"))
+    {
+        NewGame(words, count, out);
+    }
+    else if (IsCommand(words[0], "query") || IsCommand(words[0], "end"))
+    {
+        ServerGame* game = (count == 2 ? FindGame(words[1]) : nullptr);
+        if (!game)
+        {
+            AppendError(out, (count == 2 ? "No such game." : "Expected <game>."));
+        }
+        else if (IsCommand(words[0], "query"))
+        {
+            Query(*game, out);
+        }
+        else
+        {
+            EndGame(*game);
+            out += "ok\n";
+        }
+    }
+    else if (IsCommand(words[0], "stats"))
+    {
+        out += "ok ";
+        AppendUint(out, g_liveGames);
+        out += ' ';
+        AppendUint(out, g_stats.requests);
+        out += ' ';
+        AppendUint(out, g_stats.moves);
+        out += '\n';
+    }
+    else
+    {
+        AppendError(out, "Unknown command.");
+    }
+}
+
+/*
+    Answers every whole line in the client's input; with final, also the last line even without its newline.
+    Stops early and sets client.pending once the client's output reaches SERVER_MAX_OUTPUT.
+*/
+static void HandleBatch(ServerClient& client, bool final)
+{
+    uint64 start = ProfileNow();
+    PROFILE_SCOPE(PROFILE_SERVER_BATCH);
+    
+    std::string& input = client.input;
+    MemoryIndex begin = 0;
+    client.pending = false;
+    for (;;)
+    {
+        MemoryIndex end = input.find('\n', begin);
+        if (end == std::string::npos)
+        {
+            if (!final || begin >= input.size())
+                break;
+            end = input.size();
+        }
+        if (client.output.size() >= SERVER_MAX_OUTPUT)
+        {
+            client.pending = true;
+            break;
+        }
+        
+        if (client.discarding)
+        {
+            client.discarding = false;
+        }
+        else if (end - begin > SERVER_MAX_LINE)
+        {
+            g_stats.requests++;
+            AppendError(client.output, "Request too long.");
+        }
+        else
+        {
+            input[end] = '\0';
+            HandleRequest(&input[begin], client.output);
+        }
+        begin = end + 1;
+    }
+    input.erase(0, std::min(begin, input.size()));
+    
+    // A line this long is no request; answer it once and skip the rest of it.
+    if (!client.pending && input.size() > SERVER_MAX_LINE)
+    {
+        if (!client.discarding)
+        {
+            g_stats.requests++;
+            AppendError(client.output, "Request too long.");
+        }
+        client.discarding = true;
+        input.clear();
+    }
+    
+    g_stats.batches++;
+    g_stats.busyNanoseconds += ProfileNow() - start;
+}
+
+// Prints the requests per second since the last report, every reportSeconds seconds (0 for never).
+static void ReportProgress(uint32 reportSeconds)
+{
+    uint64 now = ProfileNow();
+    if (reportSeconds == 0 || now - g_reportTime < uint64(reportSeconds) * 1000000000)
+        return;
+    
+    real64 seconds = (now - g_reportTime) / 1e9;
+    std::fprintf(stderr, "%.0f requests/s, %u games in play.\n", (g_stats.requests - g_reportRequests) / seconds, g_liveGames);
+    g_reportTime = now;
+    g_reportRequests = g_stats.requests;
+}
+
+#if defined(OS_WINDOWS)
+static int64 ReadSome(int fd, char* buffer, uint32 size)
+{
+    return _read(fd, buffer, size);
+}
+
+static int64 WriteSome(int fd, const char* buffer, uint32 size)
+{
+    return _write(fd, buffer, size);
+}
+#else
+static int64 ReadSome(int fd, char* buffer, uint32 size)
+{
+    return read(fd, buffer, size);
+}
+
+static int64 WriteSome(int fd, const char* buffer, uint32 size)
+{
+    return write(fd, buffer, size);
+}
+#endif
+
+// Serves one client on stdin and stdout until stdin ends or the server is stopped.
+static ResultBool ServeStdio(uint32 reportSeconds)
+{
+    ResultBool ret = {false, ""};
+    
+    ServerClient client;
+    client.in = 0;
+    client.out = 1;
+    std::vector<char> buffer(SERVER_READ_SIZE);
+    while (!g_stop)
+    {
+        int64 bytes = ReadSome(client.in, buffer.data(), uint32(buffer.size()));
+        if (bytes < 0 && errno == EINTR)
+            continue;
+        if (bytes < 0)
+        {
+            ret.error = "Failed to read stdin.";
+            return ret;
+        }
+        
+        client.input.append(buffer.data(), MemorySize(bytes));
+        // Each batch's answers are written before the next batch, so at most SERVER_MAX_OUTPUT or so is held.
+        do
+        {
+            HandleBatch(client, bytes == 0);
+            MemoryIndex written = 0;
+            while (written < client.output.size())
+            {
+                int64 n = WriteSome(client.out, client.output.data() + written, uint32(std::min<MemorySize>(client.output.size() - written, UINT32_MAX)));
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0)
+                {
+                    ret.error = "Failed to write stdout.";
+                    return ret;
+                }
+                written += MemorySize(n);
+            }
+            client.output.clear();
+        }
+        while (client.pending);
+        ReportProgress(reportSeconds);
+        if (bytes == 0)
+            break;
+    }
+    
+    ret.result = true;
+    return ret;
+}
+
+#if defined(OS_LINUX)
+// Reads what the client sent and answers it; false once the client is gone.
+static bool ReadClient(ServerClient& client, std::vector<char>& buffer)
+{
+    int64 bytes = ReadSome(client.in, buffer.data(), uint32(buffer.size()));
+    if (bytes < 0)
+        return (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK);
+    
+    client.input.append(buffer.data(), MemorySize(bytes));
+    if (bytes == 0)
+        client.closing = true;
+    HandleBatch(client, client.closing);
+    return true;
+}
+
+// Writes as much of the client's output as the socket takes; false once the client is gone.
+static bool WriteClient(ServerClient& client)
+{
+    while (!client.output.empty())
+    {
+        ssize_t n = send(client.out, client.output.data(), client.output.size(), MSG_NOSIGNAL);
+        if (n < 0)
+            return (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK);
+        client.output.erase(0, MemorySize(n));
+    }
+    return true;
+}
+
+// Serves every client that connects to a Unix domain socket at path until the server is stopped.
+static ResultBool ServeSocket(const std::string& path, uint32 reportSeconds)
+{
+    ResultBool ret = {false, ""};
+    
+    sockaddr_un address;
+    ZERO_STRUCT(address);
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        ret.error = "Socket path " + path + " is too long.";
+        return ret;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size());
+    
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0)
+    {
+        ret.error = "Failed to create a socket.";
+        return ret;
+    }
+    unlink(path.c_str());
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(listener, SOMAXCONN) < 0)
+    {
+        close(listener);
+        ret.error = "Failed to listen on " + path + ".";
+        return ret;
+    }
+    fcntl(listener, F_SETFL, O_NONBLOCK);
+    LOG_INFO("Listening on %s.", path.c_str());
+    
+    std::vector<ServerClient> clients;
+    std::vector<pollfd> fds;
+    std::vector<char> buffer(SERVER_READ_SIZE);
+    while (!g_stop)
+    {
+        /*
+            A client is read again only once its output is written, and a batch stops at SERVER_MAX_OUTPUT, so a slow
+            reader holds up at most that much plus one answer; the lines it left are answered as its output drains.
+        */
+        fds.clear();
+        fds.push_back({listener, POLLIN, 0});
+        for (const ServerClient& client : clients)
+            fds.push_back({client.in, short(client.output.empty() ? POLLIN : POLLOUT), 0});
+        
+        int ready = poll(fds.data(), nfds_t(fds.size()), (reportSeconds ? 1000 : -1));
+        if (ready < 0 && errno != EINTR)
+        {
+            ret.error = "Failed to wait for clients.";
+            break;
+        }
+        ReportProgress(reportSeconds);
+        if (ready <= 0)
+            continue;
+        
+        for (MemoryIndex i = clients.size(); i-- > 0;)
+        {
+            ServerClient& client = clients[i];
+            short events = fds[i + 1].revents;
+            bool alive = true;
+            if (client.output.empty() && (events & (POLLIN | POLLHUP | POLLERR)))
+                alive = ReadClient(client, buffer);
+            // Most answers fit the socket buffer, so write right away instead of waiting for POLLOUT.
+            if (alive && !client.output.empty())
+                alive = WriteClient(client);
+            // Lines a batch left behind need no more input, so answer them as soon as the output before them is written.
+            while (alive && client.pending && client.output.empty())
+            {
+                HandleBatch(client, client.closing);
+                alive = WriteClient(client);
+            }
+            if (!alive || (client.closing && !client.pending && client.output.empty()))
+            {
+                close(client.in);
+                clients.erase(clients.begin() + i);
+            }
+        }
+        
+        if (fds[0].revents & POLLIN)
+        {
+            int fd;
+            while ((fd = accept(listener, nullptr, nullptr)) >= 0)
+            {
+                if (clients.size() == SERVER_MAX_CLIENTS)
+                {
+                    LOG_WARN("Too many clients; refused one.");
+                    close(fd);
+                    continue;
+                }
+                fcntl(fd, F_SETFL, O_NONBLOCK);
+                ServerClient client;
+                client.in = fd;
+                client.out = fd;
+                clients.push_back(std::move(client));
+            }
+        }
+    }
+    
+    for (const ServerClient& client : clients)
+        close(client.in);
+    close(listener);
+    unlink(path.c_str());
+    if (ret.error.empty())
+        ret.result = true;
+    return ret;
+}
+#endif
+
+int main(int argc, char* argv[])
+{
+    uint64 seed = 0;
+    bool seedSet = false;
+    std::string socketPath;
+    std::string logPath;
+    uint32 reportSeconds = 0;
+    
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--seed" && i + 1 < argc && ParseUint64(argv[i+1], seed))
+        {
+            seedSet = true;
+            i++;
+        }
+#if defined(OS_LINUX)
+        else if (arg == "--socket" && i + 1 < argc)
+        {
+            socketPath = argv[++i];
+        }
+#endif
+        else if (arg == "--log" && i + 1 < argc)
+        {
+            logPath = argv[++i];
+        }
+        else if (arg == "--report" && i + 1 < argc && ParseUint32(argv[i+1], reportSeconds))
+        {
+            i++;
+        }
+        else
+        {
+            LogUseStderr();
+            LOG_FAIL("Unknown argument: %s", arg.c_str());
+#if defined(OS_LINUX)
+            std::fprintf(stderr, "Usage: minesweeper_server [--seed <n>] [--socket <path>] [--log <file>] [--report <seconds>]\n");
+#else
+            std::fprintf(stderr, "Usage: minesweeper_server [--seed <n>] [--log <file>] [--report <seconds>]\n");
+#endif
+            return 1;
+        }
+    }
+    
+    // Responses own stdout when clients talk over it.
+    if (socketPath.empty())
+        LogUseStderr();
+    ResultBool logStart = LogStart(logPath);
+    if (!logStart)
+    {
+        LOG_FAIL("%s", logStart.error.c_str());
+        return 1;
+    }
+
+#if defined(OS_LINUX)
+    // Without SA_RESTART, so a blocked read or poll returns and the loop sees g_stop.
+    struct sigaction stop;
+    ZERO_STRUCT(stop);
+    stop.sa_handler = StopSignal;
+    sigaction(SIGINT, &stop, nullptr);
+    sigaction(SIGTERM, &stop, nullptr);
+    std::signal(SIGPIPE, SIG_IGN);
+#else
+    std::signal(SIGINT, StopSignal);
+    std::signal(SIGTERM, StopSignal);
+#endif
+
+    g_seeds.Seed(seedSet ? seed : uint64(std::time(nullptr)));
+    ProfileStart(false);
+    if (!PROFILE_ENABLED)
+        LOG_WARN("Built without MINESWEEPER_PROFILE; latencies will not be reported.");
+    
+    auto start = std::chrono::steady_clock::now();
+    g_reportTime = ProfileNow();
+    ResultBool served = {false, ""};
+#if defined(OS_LINUX)
+    if (!socketPath.empty())
+        served = ServeSocket(socketPath, reportSeconds);
+    else
+#endif
+        served = ServeStdio(reportSeconds);
+    real64 seconds = std::chrono::duration<real64>(std::chrono::steady_clock::now() - start).count();
+    if (!served)
+        LOG_FAIL("%s", served.error.c_str());
+    
+    real64 busy = g_stats.busyNanoseconds / 1e9;
+    // Results go to stderr, which the protocol never uses, and are printed so every log level keeps them.
+    LogStop();
+    std::fprintf(stderr, "Served %" PRIu64 " requests (%" PRIu64 " moves, %" PRIu64 " errors) in %" PRIu64 " batches over %.3fs: "
+                 "%.0f requests/s, %.0f requests/s while busy, %.1f requests per batch; %" PRIu64 " games started.\n",
+                 g_stats.requests, g_stats.moves, g_stats.errors, g_stats.batches, seconds,
+                 (seconds > 0 ? g_stats.requests / seconds : 0), (busy > 0 ? g_stats.requests / busy : 0),
+                 (g_stats.batches ? real64(g_stats.requests) / g_stats.batches : 0), g_stats.games);
+    ProfileReport(stderr);
+    return (served ? 0 : 1);
+}
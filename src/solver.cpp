@@ -0,0 +1,245 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+#include "solver.h"
+
+
+void Solver::Reset(const Board& board)
+{
+    m_rows = board.Rows();
+    m_cols = board.Cols();
+    m_known.assign(board.CellCount(), KNOWN_NOTHING);
+    m_queued.assign(board.CellCount(), 0);
+    m_queue.clear();
+    m_safe.clear();
+    m_mines.clear();
+    
+    for (uint32 r = 0; r < m_rows; r++)
+    {
+        const uint64* row = board.Row(PLANE_REVEALED, r);
+        for (uint32 w = 0; w < board.Stride(); w++)
+        {
+            for (uint64 bits = row[w]; bits; bits &= bits - 1)
+            {
+                uint32 c = w * 64 + CountTrailingZeros64(bits);
+                Reveal(board, board.Index(r, c));
+            }
+        }
+    }
+    Propagate(board);
+}
+
+void Solver::Update(const Board& board)
+{
+    Track(board);
+    Propagate(board);
+}
+
+void Solver::Track(const Board& board)
+{
+    for (uint32 cell : board.Changed())
+    {
+        if (board.IsRevealed(cell / m_cols, cell % m_cols) && m_known[cell] != KNOWN_REVEALED)
+            Reveal(board, cell);
+    }
+}
+
+bool Solver::NextSafe(const Board& board, uint32& cell)
+{
+    Propagate(board);
+    while (!m_safe.empty())
+    {
+        cell = m_safe.back();
+        if (!board.IsRevealed(cell / m_cols, cell % m_cols))
+            return true;
+        m_safe.pop_back();
+    }
+    return false;
+}
+
+bool Solver::NextMine(const Board& board, uint32& cell)
+{
+    Propagate(board);
+    while (!m_mines.empty())
+    {
+        cell = m_mines.back();
+        if (!board.IsFlagged(cell / m_cols, cell % m_cols))
+            return true;
+        m_mines.pop_back();
+    }
+    return false;
+}
+
+void Solver::Reveal(const Board& board, uint32 cell)
+{
+    Learn(cell, KNOWN_REVEALED);
+    if (board.MinesNearby(cell / m_cols, cell % m_cols) > 0)
+        Enqueue(cell);
+}
+
+// Records what is known about a cell and queues every revealed neighbor, since their unknowns changed.
+void Solver::Learn(uint32 cell, Knowledge k)
+{
+    m_known[cell] = uint8(k);
+    if (k == KNOWN_SAFE)
+        m_safe.push_back(cell);
+    else if (k == KNOWN_MINE)
+        m_mines.push_back(cell);
+    
+    uint32 r = cell / m_cols;
+    uint32 c = cell % m_cols;
+    for (int32 dr = -1; dr <= 1; dr++)
+    {
+        for (int32 dc = -1; dc <= 1; dc++)
+        {
+            int64 nr = int64(r) + dr;
+            int64 nc = int64(c) + dc;
+            if ((dr || dc) && nr >= 0 && nc >= 0 && nr < m_rows && nc < m_cols)
+            {
+                uint32 n = uint32(nr) * m_cols + uint32(nc);
+                if (m_known[n] == KNOWN_REVEALED)
+                    Enqueue(n);
+            }
+        }
+    }
+}
+
+void Solver::Enqueue(uint32 cell)
+{
+    if (!m_queued[cell])
+    {
+        m_queued[cell] = 1;
+        m_queue.push_back(cell);
+    }
+}
+
+void Solver::GetConstraint(const Board& board, uint32 cell, Constraint& con) const
+{
+    uint32 r = cell / m_cols;
+    uint32 c = cell % m_cols;
+    con.unknownCount = 0;
+    con.mines = board.MinesNearby(r, c);
+    for (int32 dr = -1; dr <= 1; dr++)
+    {
+        for (int32 dc = -1; dc <= 1; dc++)
+        {
+            if (!(dr || dc) || !board.InBounds(int64(r) + dr, int64(c) + dc))
+                continue;
+            
+            uint32 n = board.Index(r + dr, c + dc);
+            if (m_known[n] == KNOWN_NOTHING)
+                con.unknown[con.unknownCount++] = n;
+            else if (m_known[n] == KNOWN_MINE)
+                con.mines--;
+        }
+    }
+}
+
+bool Solver::SolveSingle(const Constraint& con)
+{
+    if (con.unknownCount == 0 || (con.mines != 0 && con.mines != int32(con.unknownCount)))
+        return false;
+    
+    Knowledge k = (con.mines == 0 ? KNOWN_SAFE : KNOWN_MINE);
+    for (uint32 i = 0; i < con.unknownCount; i++)
+        Learn(con.unknown[i], k);
+    return true;
+}
+
+bool Solver::SolvePair(const Constraint& a, const Constraint& b)
+{
+    uint32 onlyA[8];
+    uint32 onlyB[8];
+    uint32 onlyACount = 0;
+    uint32 onlyBCount = 0;
+    for (uint32 i = 0; i < a.unknownCount; i++)
+    {
+        bool shared = false;
+        for (uint32 j = 0; j < b.unknownCount; j++)
+            shared = shared || (a.unknown[i] == b.unknown[j]);
+        if (!shared)
+            onlyA[onlyACount++] = a.unknown[i];
+    }
+    for (uint32 j = 0; j < b.unknownCount; j++)
+    {
+        bool shared = false;
+        for (uint32 i = 0; i < a.unknownCount; i++)
+            shared = shared || (a.unknown[i] == b.unknown[j]);
+        if (!shared)
+            onlyB[onlyBCount++] = b.unknown[j];
+    }
+    
+    // Nothing shared means nothing to learn, and nothing exclusive means nothing to decide.
+    if (onlyACount == a.unknownCount || onlyACount + onlyBCount == 0)
+        return false;
+    
+    const uint32* mines = nullptr;
+    const uint32* safe = nullptr;
+    uint32 minesCount = 0;
+    uint32 safeCount = 0;
+    if (a.mines - b.mines == int32(onlyACount))
+    {
+        mines = onlyA; minesCount = onlyACount;
+        safe = onlyB; safeCount = onlyBCount;
+    }
+    else if (b.mines - a.mines == int32(onlyBCount))
+    {
+        mines = onlyB; minesCount = onlyBCount;
+        safe = onlyA; safeCount = onlyACount;
+    }
+    else
+    {
+        return false;
+    }
+    
+    for (uint32 i = 0; i < minesCount; i++)
+        Learn(mines[i], KNOWN_MINE);
+    for (uint32 i = 0; i < safeCount; i++)
+        Learn(safe[i], KNOWN_SAFE);
+    return true;
+}
+
+bool Solver::SolvePairs(const Board& board, uint32 cell, const Constraint& a)
+{
+    uint32 r = cell / m_cols;
+    uint32 c = cell % m_cols;
+    for (int32 dr = -2; dr <= 2; dr++)
+    {
+        for (int32 dc = -2; dc <= 2; dc++)
+        {
+            if (!(dr || dc) || !board.InBounds(int64(r) + dr, int64(c) + dc))
+                continue;
+            
+            uint32 n = board.Index(r + dr, c + dc);
+            if (m_known[n] != KNOWN_REVEALED)
+                continue;
+            
+            // Learning changes a's unknowns and Learn has already queued it again, so stop here.
+            Constraint b;
+            GetConstraint(board, n, b);
+            if (b.unknownCount > 0 && SolvePair(a, b))
+                return true;
+        }
+    }
+    return false;
+}
+
+void Solver::Propagate(const Board& board)
+{
+    // The queue is a stack; order does not change the fixpoint.
+    while (!m_queue.empty())
+    {
+        uint32 cell = m_queue.back();
+        m_queue.pop_back();
+        m_queued[cell] = 0;
+        
+        Constraint a;
+        GetConstraint(board, cell, a);
+        if (a.unknownCount > 0 && !SolveSingle(a))
+            SolvePairs(board, cell, a);
+    }
+}
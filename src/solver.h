@@ -0,0 +1,81 @@
+/*
+    ====================================
+     Copyright (C) 2020 Daniel M Tyler.
+     This file is part of Minesweeper.
+    ====================================
+*/
+
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include "common.h"
+#include "board.h"
+
+#include <vector>
+
+
+enum Knowledge
+{
+    KNOWN_NOTHING,
+    KNOWN_SAFE, // Covered, but provably not a mine.
+    KNOWN_MINE, // Covered and provably a mine.
+    KNOWN_REVEALED
+};
+
+/*
+    Finds provably safe cells and provable mines using only what a player can see:
+    which cells are revealed and their neighboring mine counts (mines and flags are never read).
+
+    Every revealed number is a constraint "the unknown neighbors hold count - known mines mines".
+    A constraint is solved on its own when it needs zero or all of its unknowns,
+    and in pairs with every constraint within two cells:
+        if mines(A) - mines(B) == |A \ B| then A \ B are all mines and B \ A are all safe.
+    Only constraints whose unknowns changed are rechecked, so each Update costs
+    time proportional to what the last move revealed, not to the board size.
+*/
+class Solver
+{
+public:
+    // Starts tracking a new game; scans the board once for cells that are already revealed.
+    void Reset(const Board& board);
+    // Feeds the cells changed by the board's last move and propagates until nothing new can be proven.
+    void Update(const Board& board);
+    // As Update, but leaves the propagation to the next NextSafe or NextMine, so moves nobody asks about cost
+    // next to nothing; call it after every move just the same.
+    void Track(const Board& board);
+    
+    // Only complete after Update, NextSafe or NextMine.
+    Knowledge Known(uint32 cell) const { return Knowledge(m_known[cell]); }
+    // Finds a provably safe cell that is still covered; false if none is known.
+    bool NextSafe(const Board& board, uint32& cell);
+    // Finds a provable mine that is not flagged yet; false if none is known.
+    bool NextMine(const Board& board, uint32& cell);
+
+private:
+    struct Constraint
+    {
+        uint32 unknown[8];
+        uint32 unknownCount;
+        int32 mines; // Mines left among unknown.
+    };
+    
+    void Reveal(const Board& board, uint32 cell);
+    void Learn(uint32 cell, Knowledge k);
+    void Enqueue(uint32 cell);
+    void Propagate(const Board& board);
+    void GetConstraint(const Board& board, uint32 cell, Constraint& con) const;
+    bool SolveSingle(const Constraint& con);
+    bool SolvePair(const Constraint& a, const Constraint& b);
+    // Tries SolvePair against every revealed cell within two cells of cell.
+    bool SolvePairs(const Board& board, uint32 cell, const Constraint& a);
+    
+    uint32 m_rows = 0;
+    uint32 m_cols = 0;
+    std::vector<uint8> m_known;
+    std::vector<uint8> m_queued;
+    std::vector<uint32> m_queue;
+    std::vector<uint32> m_safe; // Cells learned safe; some may since have been revealed.
+    std::vector<uint32> m_mines; // Cells learned to be mines; some may since have been flagged.
+};
+
+#endif